@@ -0,0 +1,137 @@
+#include <utils.h>
+
+#include <algorithm>
+#include <component_store.h>
+#include <vector>
+
+// Creates and destroys entities of several archetypes across chunk boundaries and checks that Get, Alive, Count and
+// Query still agree with what is expected to be left, and that freed indices are reused with a bumped generation
+
+struct Small {
+    u32 value;
+};
+
+// Large enough that an archetype with it only fits a few hundred entities per chunk
+struct Large {
+    u32 value;
+    u8 padding[60];
+};
+
+struct Alone {
+    u64 value;
+};
+
+static void Check(const bool condition, const char *what)
+{
+    if (!condition) {
+        printf("ComponentStore test failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+struct Expected {
+    utils::Entity entity;
+    u32 value;
+    bool has_small;
+    bool has_large;
+};
+
+static utils::Entity Create(utils::ComponentStore &store, std::vector<Expected> &expected, const u32 kind)
+{
+    const u32 value = static_cast<u32>(expected.size()) * 7 + 1;
+    utils::Entity entity;
+    if (kind == 0) {
+        entity = store.Create(Small{value});
+    } else if (kind == 1) {
+        entity = store.Create(Small{value}, Large{value, {}});
+    } else {
+        entity = store.Create(Alone{value});
+    }
+    expected.push_back({entity, value, kind != 2, kind == 1});
+    return entity;
+}
+
+static void CheckContents(utils::ComponentStore &store, const std::vector<Expected> &alive)
+{
+    u32 small_count = 0;
+    u32 large_count = 0;
+    for (const auto &entry : alive) {
+        Check(store.Alive(entry.entity), "a live entity isn't Alive");
+        if (entry.has_small) {
+            Check(store.Get<Small>(entry.entity).value == entry.value, "Get<Small> returned another entity's data");
+            small_count++;
+        }
+        if (entry.has_large) {
+            Check(store.Get<Large>(entry.entity).value == entry.value, "Get<Large> returned another entity's data");
+            large_count++;
+        }
+        if (!entry.has_small) {
+            Check(store.Get<Alone>(entry.entity).value == entry.value, "Get<Alone> returned another entity's data");
+        }
+    }
+    Check(store.Count<Small>() == small_count, "Count<Small> is wrong");
+    Check(store.Count<Small, Large>() == large_count, "Count<Small, Large> is wrong");
+    Check(store.Count<Large>() == large_count, "Count<Large> is wrong");
+    Check(store.Count<Alone>() == alive.size() - small_count, "Count<Alone> is wrong");
+
+    // Every queried row belongs to a live entity whose components are in that row, and no chunk is left empty
+    u32 queried = 0;
+    for (const auto &chunk : store.Query<Small>()) {
+        Check(chunk.count > 0, "Query returned an empty chunk");
+        for (u32 i = 0; i < chunk.count; i++) {
+            Check(store.Alive(chunk.entities[i]), "Query returned a destroyed entity");
+            Check(&store.Get<Small>(chunk.entities[i]) == &chunk.Column<Small>()[i], "Query row and Get disagree");
+            queried++;
+        }
+    }
+    Check(queried == small_count, "Query<Small> didn't return every entity exactly once");
+}
+
+int main()
+{
+    constexpr u32 count_per_kind = 1000;
+    utils::ComponentStore store;
+    std::vector<Expected> alive;
+    for (u32 i = 0; i < count_per_kind * 3; i++) {
+        Create(store, alive, i % 3);
+    }
+    CheckContents(store, alive);
+
+    // Destroy every third entity from the middle, then the newest ones from the end, which empties whole chunks
+    std::vector<Expected> destroyed;
+    std::vector<Expected> kept;
+    for (u32 i = 0; i < alive.size(); i++) {
+        const bool from_middle = i % 3 == 1 && i < alive.size() / 2;
+        const bool from_end = i >= alive.size() - alive.size() / 4;
+        if (from_middle || from_end) {
+            store.Destroy(alive[i].entity);
+            destroyed.push_back(alive[i]);
+        } else {
+            kept.push_back(alive[i]);
+        }
+    }
+    for (const auto &entry : destroyed) {
+        Check(!store.Alive(entry.entity), "a destroyed entity is still Alive");
+        // Destroying a stale handle again has to leave the store untouched
+        store.Destroy(entry.entity);
+    }
+    CheckContents(store, kept);
+
+    // Re-created entities reuse the freed indices, with a generation one higher than the destroyed entity had
+    std::vector<Expected> recreated;
+    for (u32 i = 0; i < destroyed.size(); i++) {
+        Create(store, recreated, i % 3);
+    }
+    for (const auto &entry : recreated) {
+        const auto old = std::find_if(destroyed.begin(), destroyed.end(),
+            [&entry](const Expected &other) { return other.entity.index == entry.entity.index; });
+        Check(old != destroyed.end(), "a re-created entity didn't reuse a freed index");
+        Check(entry.entity.generation == old->entity.generation + 1, "a reused index kept its generation");
+        Check(!store.Alive(old->entity), "the old handle of a reused index is Alive again");
+    }
+    kept.insert(kept.end(), recreated.begin(), recreated.end());
+    CheckContents(store, kept);
+
+    printf("ComponentStore ok\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <utils.h>
+
+#include <occupancy_mask.h>
+#include <vector>
+
+// Checks the OccupancyMask queries that the static_asserts in its header don't cover
+
+static void Check(const bool condition, const char *what)
+{
+    if (!condition) {
+        printf("OccupancyMask test failed: %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static std::vector<u32> Indices(const utils::OccupancyMask &mask)
+{
+    std::vector<u32> indices;
+    mask.ForEach([&indices](const u32 index) { indices.push_back(index); });
+    return indices;
+}
+
+static void ForEachOrder()
+{
+    using utils::OccupancyMask;
+    Check(Indices({}).empty(), "ForEach visited a voxel of an empty mask");
+
+    OccupancyMask mask;
+    mask.Set(3, 3, 3);
+    mask.Set(0, 0, 0);
+    mask.Set(2, 1, 0);
+    mask.Set(1, 0, 2);
+    const std::vector<u32> expected = {OccupancyMask::Index(0, 0, 0), OccupancyMask::Index(2, 1, 0),
+        OccupancyMask::Index(1, 0, 2), OccupancyMask::Index(3, 3, 3)};
+    Check(Indices(mask) == expected, "ForEach didn't visit the set voxels in ascending index order");
+
+    const auto full = Indices(OccupancyMask::Full());
+    Check(full.size() == OccupancyMask::voxel_count, "ForEach didn't visit every voxel of a full mask");
+    for (u32 i = 0; i < full.size(); i++) {
+        Check(full[i] == i, "ForEach visited a full mask out of order");
+    }
+}
+
+static void First()
+{
+    using utils::OccupancyMask;
+    Check(OccupancyMask{}.First() == OccupancyMask::voxel_count, "First() of an empty mask isn't voxel_count");
+    Check(OccupancyMask::Full().First() == 0, "First() of a full mask isn't 0");
+
+    OccupancyMask mask;
+    mask.Set(3, 3, 3);
+    Check(mask.First() == OccupancyMask::voxel_count - 1, "First() missed the last voxel");
+    mask.Set(1, 2, 1);
+    Check(mask.First() == OccupancyMask::Index(1, 2, 1), "First() didn't return the lowest set voxel");
+    mask.Clear(1, 2, 1);
+    Check(mask.First() == OccupancyMask::voxel_count - 1, "First() still returned a cleared voxel");
+}
+
+static void BoxEdgeCases()
+{
+    using utils::OccupancyMask;
+    constexpr u32 last = OccupancyMask::dimension - 1;
+    for (u32 z = 0; z <= last; z++) {
+        for (u32 y = 0; y <= last; y++) {
+            for (u32 x = 0; x <= last; x++) {
+                Check(OccupancyMask::Box(x, y, z, x, y, z).bits == OccupancyMask::Bit(x, y, z),
+                    "a single voxel box didn't set exactly that voxel");
+            }
+        }
+    }
+
+    // Full extent along one axis and a single voxel along the others
+    const auto row = OccupancyMask::Box(0, 2, 3, last, 2, 3);
+    Check(row.Count() == OccupancyMask::dimension && row.Row(2, 3) == OccupancyMask::row_bits,
+        "a full width box isn't one full row");
+    const auto column = OccupancyMask::Box(3, 0, 1, 3, last, 1);
+    Check(column.Count() == OccupancyMask::dimension && column.Slab(1) == 0x8888, "a full height box is wrong");
+    const auto slab = OccupancyMask::Box(0, 0, last, last, last, last);
+    Check(slab.Slab(last) == OccupancyMask::slab_bits && slab.Count() == 16, "a full slab box is wrong");
+    Check(slab.Slab(0) == 0 && slab.Row(0, last) == OccupancyMask::row_bits, "a full slab box leaked into others");
+
+    // A box along the upper edge must not shift any bits past the end of the mask
+    const auto corner = OccupancyMask::Box(2, 2, 2, last, last, last);
+    Check(corner.Count() == 8 && corner.Test(last, last, last) && !corner.Test(1, last, last),
+        "a box in the upper corner is wrong");
+    Check((OccupancyMask::Full() & ~corner).Count() == OccupancyMask::voxel_count - 8, "~ of a box is wrong");
+    Check(OccupancyMask::Full().Contains(corner) && !corner.Contains(OccupancyMask::Full()), "Contains is wrong");
+}
+
+int main()
+{
+    ForEachOrder();
+    First();
+    BoxEdgeCases();
+    printf("OccupancyMask ok\n");
+    return 0;
+}
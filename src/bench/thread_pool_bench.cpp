@@ -0,0 +1,107 @@
+#include <utils.h>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <thread_pool.h>
+#include <vector>
+
+// Times ParallelFor and a layered job graph for every worker count from 0 up to one less than the hardware thread
+// count, and prints the speedup over running everything on the calling thread
+//
+//   ThreadPoolBench [max workers]
+
+static constexpr u32 item_count = 1 << 16;
+static constexpr u32 grain_size = 256;
+static constexpr u32 graph_width = 64;
+static constexpr u32 graph_depth = 32;
+static constexpr u32 repetitions = 5;
+
+// CPU bound work that doesn't touch memory, so the scaling isn't limited by bandwidth
+static f32 Work(const u32 item)
+{
+    f32 x = static_cast<f32>(item) * 0.001f;
+    for (u32 i = 0; i < 256; i++) {
+        x = std::sin(x) * 0.5f + std::cos(x) * 0.5f;
+    }
+    return x;
+}
+
+static f64 TimeParallelFor(utils::ThreadPool &pool, std::vector<f32> &results)
+{
+    const auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor(0, item_count, grain_size, [&results](const u32 begin, const u32 end) {
+        for (u32 i = begin; i < end; i++) {
+            results[i] = Work(i);
+        }
+    });
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// graph_depth layers of graph_width jobs, where every job waits for the two jobs above it in the previous layer
+static f64 TimeJobGraph(utils::ThreadPool &pool, std::vector<f32> &results)
+{
+    const auto start = std::chrono::steady_clock::now();
+    utils::TaskGroup group;
+    std::vector<utils::ThreadPool::Job *> jobs(graph_width * graph_depth);
+    for (u32 layer = 0; layer < graph_depth; layer++) {
+        for (u32 column = 0; column < graph_width; column++) {
+            const u32 index = layer * graph_width + column;
+            jobs[index] = pool.Create(group, [&results, index] {
+                for (u32 i = 0; i < item_count / (graph_width * graph_depth); i++) {
+                    results[index] += Work(i);
+                }
+            });
+            if (layer > 0) {
+                pool.Precede(jobs[index - graph_width], jobs[index]);
+                pool.Precede(jobs[(layer - 1) * graph_width + (column + 1) % graph_width], jobs[index]);
+            }
+        }
+    }
+    for (auto *job : jobs) {
+        pool.Submit(job);
+    }
+    pool.Wait(group);
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best of several runs, which filters out interference from the rest of the system
+template<typename F>
+static f64 Best(F &&run)
+{
+    f64 best = run();
+    for (u32 i = 1; i < repetitions; i++) {
+        best = std::min(best, run());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const u32 hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const u32 max_workers = argc > 1 ? static_cast<u32>(atoi(argv[1])) : hardware_threads - 1;
+
+    std::vector<f32> results(item_count);
+    f64 parallel_for_baseline = 0.0;
+    f64 job_graph_baseline = 0.0;
+    printf("%8s %16s %8s %16s %8s\n", "threads", "ParallelFor ms", "speedup", "job graph ms", "speedup");
+    for (u32 workers = 0; workers <= max_workers; workers++) {
+        utils::ThreadPool pool(workers);
+        const f64 parallel_for = Best([&] { return TimeParallelFor(pool, results); });
+        const f64 job_graph = Best([&] { return TimeJobGraph(pool, results); });
+        if (workers == 0) {
+            parallel_for_baseline = parallel_for;
+            job_graph_baseline = job_graph;
+        }
+        printf("%8u %16.3f %8.2f %16.3f %8.2f\n", workers + 1, parallel_for, parallel_for_baseline / parallel_for,
+            job_graph, job_graph_baseline / job_graph);
+    }
+
+    // Keeps the work from being optimised away
+    f32 checksum = 0.0f;
+    for (const auto result : results) {
+        checksum += result;
+    }
+    printf("checksum %f\n", checksum);
+    return 0;
+}
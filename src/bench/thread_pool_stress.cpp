@@ -0,0 +1,109 @@
+#include <utils.h>
+
+#include <atomic>
+#include <thread_pool.h>
+#include <vector>
+
+// Stress test for the ThreadPool, meant to be run under ThreadSanitizer (configure with
+// -DCMAKE_CXX_FLAGS=-fsanitize=thread). Runs nested ParallelFor calls and diamond shaped job graphs at several worker
+// counts and checks that every job ran exactly once and after everything it was chained after.
+
+static constexpr u32 iterations = 200;
+
+static void Check(const bool condition, const char *what, const u32 workers)
+{
+    if (!condition) {
+        printf("ThreadPool stress test failed with %u workers: %s\n", workers, what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void NestedParallelFor(utils::ThreadPool &pool, const u32 workers)
+{
+    constexpr u32 outer_count = 64;
+    constexpr u32 inner_count = 256;
+    std::vector<u32> counts(outer_count * inner_count, 0);
+    pool.ParallelFor(0, outer_count, 1, [&](const u32 outer_begin, const u32 outer_end) {
+        for (u32 outer = outer_begin; outer < outer_end; outer++) {
+            pool.ParallelFor(0, inner_count, 16, [&](const u32 begin, const u32 end) {
+                for (u32 inner = begin; inner < end; inner++) {
+                    counts[outer * inner_count + inner]++;
+                }
+            });
+        }
+    });
+    for (const auto count : counts) {
+        Check(count == 1, "nested ParallelFor visited an item other than once", workers);
+    }
+}
+
+// top -> (left, right) -> bottom, many diamonds at once. Each job records the order it ran in, and bottom checks that
+// both sides finished before it.
+static void DiamondGraphs(utils::ThreadPool &pool, const u32 workers)
+{
+    constexpr u32 diamond_count = 128;
+    struct Diamond {
+        u32 top = 0;
+        u32 left = 0;
+        u32 right = 0;
+        u32 bottom = 0;
+        bool bottom_saw_sides = false;
+    };
+    std::vector<Diamond> diamonds(diamond_count);
+    utils::TaskGroup group;
+    std::vector<utils::ThreadPool::Job *> jobs;
+    for (auto &diamond : diamonds) {
+        auto *top = pool.Create(group, [&diamond] { diamond.top++; });
+        auto *left = pool.Create(group, [&diamond] { diamond.left += diamond.top; });
+        auto *right = pool.Create(group, [&diamond] { diamond.right += diamond.top; });
+        auto *bottom = pool.Create(group, [&diamond] {
+            diamond.bottom++;
+            diamond.bottom_saw_sides = diamond.left == 1 && diamond.right == 1;
+        });
+        pool.Precede(top, left);
+        pool.Precede(top, right);
+        pool.Precede(left, bottom);
+        pool.Precede(right, bottom);
+        // Submit in reverse so the dependencies, not submission order, decide when jobs run
+        jobs.insert(jobs.end(), {bottom, right, left, top});
+    }
+    for (auto *job : jobs) {
+        pool.Submit(job);
+    }
+    pool.Wait(group);
+    for (const auto &diamond : diamonds) {
+        Check(diamond.top == 1 && diamond.bottom == 1, "a diamond job ran other than once", workers);
+        Check(diamond.bottom_saw_sides, "a job ran before the jobs it was chained after", workers);
+    }
+}
+
+// Jobs that add more jobs to the group that is being waited on
+static void SubmitFromJobs(utils::ThreadPool &pool, const u32 workers)
+{
+    constexpr u32 job_count = 256;
+    std::atomic<u32> ran = 0;
+    utils::TaskGroup group;
+    for (u32 i = 0; i < job_count; i++) {
+        pool.Run(group, [&] {
+            // Jobs reach the pool they run on through Current(), like the systems do
+            Check(utils::ThreadPool::Current() == &pool, "Current() isn't the pool running the job", workers);
+            utils::ThreadPool::Current()->Run(group, [&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+    pool.Wait(group);
+    Check(ran.load() == job_count, "a job submitted from another job was lost", workers);
+}
+
+int main()
+{
+    for (const u32 workers : {0u, 1u, 3u, 7u}) {
+        utils::ThreadPool pool(workers);
+        for (u32 i = 0; i < iterations; i++) {
+            NestedParallelFor(pool, workers);
+            DiamondGraphs(pool, workers);
+            SubmitFromJobs(pool, workers);
+        }
+        printf("%u workers ok\n", workers);
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "event_source.h"
+
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+#ifdef HEADLESS_ONLY
+// Stand-in for SDL_GetKeyFromName when the SDL library isn't linked. Covers the trace dump key and the keys whose
+// key code is their lower case character.
+static SDL_Keycode KeyFromName(const std::string &name)
+{
+    if (name == "F12" || name == "f12") {
+        return SDLK_F12;
+    }
+    if (name.size() == 1 && std::isprint(static_cast<unsigned char>(name[0]))) {
+        return std::tolower(static_cast<unsigned char>(name[0]));
+    }
+    return SDLK_UNKNOWN;
+}
+#else
+static SDL_Keycode KeyFromName(const std::string &name)
+{
+    return SDL_GetKeyFromName(name.c_str());
+}
+#endif
+
+#ifndef HEADLESS_ONLY
+bool WindowedPlaybackEventSource::Poll(SDL_Event *event)
+{
+    SDL_Event window_event;
+    while (_window.Poll(&window_event)) {
+        if (window_event.type == SDL_QUIT) {
+            *event = window_event;
+            return true;
+        }
+    }
+    return _playback->Poll(event);
+}
+#endif
+
+void PlaybackEventSource::AppendQuit()
+{
+    SDL_Event quit = {};
+    quit.type = SDL_QUIT;
+    _frames.back().push_back(quit);
+}
+
+bool PlaybackEventSource::Poll(SDL_Event *event)
+{
+    if (_frame >= _frames.size()) {
+        return false;
+    }
+    if (_event >= _frames[_frame].size()) {
+        _frame++;
+        _event = 0;
+        return false;
+    }
+    *event = _frames[_frame][_event++];
+    return true;
+}
+
+ScriptedEventSource::ScriptedEventSource(const char *script_path)
+{
+    std::istringstream script(utils::ReadEntireFileAsString(script_path));
+
+    std::string line;
+    for (u32 line_number = 1; std::getline(script, line); line_number++) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string command;
+        if (!(words >> command)) {
+            continue;
+        }
+
+        SDL_Event event = {};
+        s32 x = 0;
+        s32 y = 0;
+        if (command == "down" || command == "up") {
+            words >> x >> y;
+            event.type = command == "down" ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            event.button.button = SDL_BUTTON_LEFT;
+            event.button.x = x;
+            event.button.y = y;
+        } else if (command == "move") {
+            words >> x >> y;
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = x;
+            event.motion.y = y;
+        } else if (command == "key") {
+            std::string name;
+            words >> name;
+            event.type = SDL_KEYDOWN;
+            event.key.keysym.sym = KeyFromName(name);
+        } else if (command == "quit") {
+            event.type = SDL_QUIT;
+        } else if (command == "frame") {
+            // The count is optional, but if one is given it has to be valid
+            s32 count = 1;
+            if (!(words >> std::ws).eof()) {
+                words >> count;
+                if (words.fail() || count < 1 || count > max_frame_count) {
+                    printf("%s:%u: frame count has to be between 1 and %d\n", script_path, line_number,
+                        max_frame_count);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            for (s32 i = 0; i < count; i++) {
+                _frames.emplace_back();
+            }
+            continue;
+        } else {
+            printf("%s:%u: unknown input script command '%s'\n", script_path, line_number, command.c_str());
+            exit(EXIT_FAILURE);
+        }
+        if (words.fail()) {
+            printf("%s:%u: missing arguments for '%s'\n", script_path, line_number, command.c_str());
+            exit(EXIT_FAILURE);
+        }
+        _frames.back().push_back(event);
+    }
+    AppendQuit();
+}
+
+InputLogWriter::InputLogWriter(const char *log_path) :
+        _file(utils::OpenFile(log_path, utils::FilePermissions::BinaryWrite))
+{
+    fwrite(input_log::magic, sizeof(input_log::magic), 1, _file);
+    WriteValue(input_log::version, 4);
+}
+
+InputLogWriter::~InputLogWriter()
+{
+    fclose(_file);
+}
+
+void InputLogWriter::Write(const SDL_Event &event)
+{
+    switch (event.type) {
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+        WriteRecordHeader(
+            event.type == SDL_MOUSEBUTTONDOWN ? input_log::RecordType::MouseDown : input_log::RecordType::MouseUp);
+        WriteValue(event.button.button, 1);
+        WriteValue(static_cast<u16>(event.button.x), 2);
+        WriteValue(static_cast<u16>(event.button.y), 2);
+        break;
+    case SDL_MOUSEMOTION:
+        WriteRecordHeader(input_log::RecordType::MouseMotion);
+        WriteValue(static_cast<u16>(event.motion.x), 2);
+        WriteValue(static_cast<u16>(event.motion.y), 2);
+        break;
+    case SDL_KEYDOWN:
+        WriteRecordHeader(input_log::RecordType::KeyDown);
+        WriteValue(static_cast<u32>(event.key.keysym.sym), 4);
+        break;
+    case SDL_QUIT:
+        WriteRecordHeader(input_log::RecordType::Quit);
+        break;
+    default:
+        break;
+    }
+}
+
+void InputLogWriter::EndFrame()
+{
+    WriteRecordHeader(input_log::RecordType::FrameEnd);
+}
+
+void InputLogWriter::WriteRecordHeader(const input_log::RecordType type)
+{
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+    WriteValue(static_cast<u8>(type), 1);
+    WriteValue(static_cast<u32>(elapsed.count()), 4);
+}
+
+void InputLogWriter::WriteValue(const u32 value, const u32 byte_count)
+{
+    for (u32 i = 0; i < byte_count; i++) {
+        fputc(static_cast<u8>(value >> (i * 8)), _file);
+    }
+}
+
+ReplayEventSource::ReplayEventSource(const char *log_path)
+{
+    const auto log = utils::ReadEntireFileAsVector(log_path);
+    Size offset = 0;
+    const auto read = [&](const u32 byte_count) {
+        if (offset + byte_count > log.size()) {
+            printf("%s: input log is truncated\n", log_path);
+            exit(EXIT_FAILURE);
+        }
+        u32 value = 0;
+        for (u32 i = 0; i < byte_count; i++) {
+            value |= static_cast<u32>(log[offset++]) << (i * 8);
+        }
+        return value;
+    };
+
+    if (log.size() < sizeof(input_log::magic) || memcmp(log.data(), input_log::magic, sizeof(input_log::magic)) != 0) {
+        printf("%s: not an input log\n", log_path);
+        exit(EXIT_FAILURE);
+    }
+    offset += sizeof(input_log::magic);
+    if (const u32 version = read(4); version != input_log::version) {
+        printf("%s: unsupported input log version %u\n", log_path, version);
+        exit(EXIT_FAILURE);
+    }
+
+    while (offset < log.size()) {
+        const auto type = static_cast<input_log::RecordType>(read(1));
+        SDL_Event event = {};
+        event.common.timestamp = read(4);
+        switch (type) {
+        case input_log::RecordType::FrameEnd:
+            _frames.emplace_back();
+            continue;
+        case input_log::RecordType::MouseDown:
+        case input_log::RecordType::MouseUp:
+            event.type = type == input_log::RecordType::MouseDown ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+            event.button.button = static_cast<u8>(read(1));
+            event.button.x = static_cast<s16>(read(2));
+            event.button.y = static_cast<s16>(read(2));
+            break;
+        case input_log::RecordType::MouseMotion:
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = static_cast<s16>(read(2));
+            event.motion.y = static_cast<s16>(read(2));
+            break;
+        case input_log::RecordType::KeyDown:
+            event.type = SDL_KEYDOWN;
+            event.key.keysym.sym = static_cast<SDL_Keycode>(read(4));
+            break;
+        case input_log::RecordType::Quit:
+            event.type = SDL_QUIT;
+            break;
+        default:
+            printf("%s: unknown input log record %u\n", log_path, static_cast<u32>(type));
+            exit(EXIT_FAILURE);
+        }
+        _frames.back().push_back(event);
+    }
+    AppendQuit();
+}
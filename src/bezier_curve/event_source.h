@@ -0,0 +1,145 @@
+#pragma once
+#include <utils.h>
+
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Where the InputSystem gets its events from. Only used by the thread that pumps input, which is the main thread.
+class EventSource
+{
+  public:
+    virtual ~EventSource() = default;
+    // Fills in the next event, returns false once there are none left for now. For sources that deliver frames,
+    // returning false ends the current frame.
+    virtual bool Poll(SDL_Event *event) = 0;
+    // Blocks until an event is available without consuming it
+    virtual void Wait() = 0;
+    // Makes a Wait() that is blocked on another thread return. May be called from any thread.
+    virtual void Wake() = 0;
+    // True if the events are grouped into frames that have to be handed to the simulation one frame per frame, rather
+    // than whenever they arrive
+    virtual bool DeliversFrames() const = 0;
+};
+
+#ifndef HEADLESS_ONLY
+// Events from the window, the normal interactive source. Has to be used on the thread that created the window.
+class SDLEventSource : public EventSource
+{
+  public:
+    bool Poll(SDL_Event *event) override { return SDL_PollEvent(event) > 0; }
+    void Wait() override { SDL_WaitEvent(nullptr); }
+    void Wake() override
+    {
+        SDL_Event event = {};
+        event.type = SDL_USEREVENT;
+        SDL_PushEvent(&event);
+    }
+    bool DeliversFrames() const override { return false; }
+};
+
+// Plays back another source while a window is open. The window's events are drained on every poll so it stays
+// responsive, and closing it quits, but its mouse and keyboard input is dropped so it can't disturb the playback.
+// Has to be used on the thread that created the window.
+class WindowedPlaybackEventSource : public EventSource
+{
+    std::unique_ptr<EventSource> _playback;
+    SDLEventSource _window;
+
+  public:
+    explicit WindowedPlaybackEventSource(std::unique_ptr<EventSource> playback) : _playback(std::move(playback)) {}
+    bool Poll(SDL_Event *event) override;
+    void Wait() override { _playback->Wait(); }
+    void Wake() override { _playback->Wake(); }
+    bool DeliversFrames() const override { return _playback->DeliversFrames(); }
+};
+#endif
+
+// Plays back a prepared list of events frame by frame, regardless of how long each frame takes, and quits once it
+// runs out
+class PlaybackEventSource : public EventSource
+{
+    u32 _frame = 0;
+    u32 _event = 0;
+
+  protected:
+    std::vector<std::vector<SDL_Event>> _frames;
+
+    PlaybackEventSource() : _frames(1) {}
+    void AppendQuit();
+
+  public:
+    bool Poll(SDL_Event *event) override;
+    // The next frame always has its events ready
+    void Wait() override {}
+    void Wake() override {}
+    bool DeliversFrames() const override { return true; }
+};
+
+// Events read from a text script, for running without a window. Each line is one command:
+//
+//   down <x> <y>     left mouse button pressed at the screen position
+//   move <x> <y>     mouse moved to the screen position
+//   up <x> <y>       left mouse button released at the screen position
+//   key <name>       key pressed, named as in SDL_GetKeyFromName, e.g. F12. Builds without the SDL library only
+//                    know F12 and single character names.
+//   frame [count]    ends the current frame, or count frames (at most 1000000), the following commands happen in the
+//                    next one
+//   quit             quits, also sent automatically once the script runs out
+//
+// Everything after a # is a comment.
+class ScriptedEventSource : public PlaybackEventSource
+{
+    // Upper bound for a single frame command, so a typo can't allocate billions of empty frames
+    static constexpr s32 max_frame_count = 1000000;
+
+  public:
+    explicit ScriptedEventSource(const char *script_path);
+};
+
+// Binary input log written by the InputLogWriter. After the header, every record starts with a one byte
+// RecordType and the time since recording started in milliseconds as a u32, followed by the payload of that type.
+// All values are little endian.
+namespace input_log
+{
+constexpr char magic[4] = {'V', 'D', 'I', 'N'};
+constexpr u32 version = 1;
+
+enum class RecordType : u8 {
+    FrameEnd,    // no payload
+    MouseDown,   // u8 button, s16 x, s16 y
+    MouseUp,     // u8 button, s16 x, s16 y
+    MouseMotion, // s16 x, s16 y
+    KeyDown,     // s32 key code
+    Quit,        // no payload
+};
+} // namespace input_log
+
+// Writes the events the InputSystem consumes to an input log, grouped by the frame that consumed them. Only the event
+// types the InputSystem handles are recorded.
+class InputLogWriter
+{
+    FILE *_file;
+    std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+
+  public:
+    explicit InputLogWriter(const char *log_path);
+    ~InputLogWriter();
+    InputLogWriter(const InputLogWriter &) = delete;
+    InputLogWriter &operator=(const InputLogWriter &) = delete;
+
+    void Write(const SDL_Event &event);
+    void EndFrame();
+
+  private:
+    void WriteRecordHeader(input_log::RecordType type);
+    void WriteValue(u32 value, u32 byte_count);
+};
+
+// Replays an input log one recorded frame per frame, so the same session can be run again independent of timing
+class ReplayEventSource : public PlaybackEventSource
+{
+  public:
+    explicit ReplayEventSource(const char *log_path);
+};
@@ -1,29 +1,141 @@
 #include "glm/gtx/compatibility.hpp"
 #include <utils.h>
 
+#include "event_source.h"
+
 #include <SDL2/SDL.h>
+#include <algorithm>
+#include <arena.h>
+#include <atomic>
+#include <component_store.h>
+#include <counters.h>
+#include <cstring>
+#ifndef HEADLESS_ONLY
 #include <focus.hpp>
+#endif
+#include <frame_pacer.h>
 #include <glm/vec2.hpp>
 #include <memory>
 #include <optional>
+#include <profiler.h>
+#include <spsc_queue.h>
+#include <thread>
+#include <thread_pool.h>
+#include <trace.h>
+
+// Bit flags for the DataManager fields, used by systems to declare which of them they access
+enum class DataField : u32 {
+    None = 0,
+    ShouldQuit = 1 << 0,
+    MouseHeldPos = 1 << 1,
+    ControlPoints = 1 << 2,
+    BezierLineSegments = 1 << 3,
+    RenderState = 1 << 4,
+    TraceDumpRequested = 1 << 5,
+    All = ~0u,
+};
+
+constexpr DataField operator|(DataField a, DataField b)
+{
+    return static_cast<DataField>(static_cast<u32>(a) | static_cast<u32>(b));
+}
+
+constexpr bool Overlaps(DataField a, DataField b)
+{
+    return (static_cast<u32>(a) & static_cast<u32>(b)) != 0;
+}
+
+struct DataAccess {
+    DataField reads = DataField::None;
+    DataField writes = DataField::None;
+
+    // Two systems conflict if either one writes something the other one touches
+    bool ConflictsWith(const DataAccess &other) const
+    {
+        return Overlaps(writes, other.reads | other.writes) || Overlaps(other.writes, reads | writes);
+    }
+};
+
+//
+// Curve components, every curve is an entity in DataManager::curves with both of them
+//
+
+struct ControlPoints {
+    glm::vec2 points[3];
+    // Set when a point moves, cleared by the RenderStateSystem once the curve has been copied into render_state. The
+    // per-curve flags are the only record of what changed, DataManager::AnyDirty() derives the global state from them.
+    bool dirty = true;
+};
+
+struct BezierSegments {
+    static constexpr u32 count = 100;
+    glm::vec2 points[count] = {};
+    // Set when the curve was re-tessellated, cleared by the RenderStateSystem like ControlPoints::dirty
+    bool dirty = true;
+};
+
+// Copy of everything the RenderSystem needs, so frame N can be submitted while frame N + 1 is being simulated
+struct RenderState {
+    // The points of all curves back to back, in query order
+    std::vector<glm::vec2> control_points;
+    std::vector<glm::vec2> bezier_line_segments;
+    // Set when the matching data changed since the last upload, cleared by the RenderSystem
+    bool control_points_dirty = false;
+    bool bezier_line_segments_dirty = false;
+};
 
 struct DataManager {
     static constexpr f32 point_size = 10.0f;
     static constexpr s32 screen_width = 720;
     static constexpr s32 screen_height = 640;
+    static constexpr f64 target_frame_rate = 60.0;
+    static constexpr f64 profile_report_interval = 5.0; // seconds
+    static constexpr SDL_Keycode trace_dump_key = SDLK_F12;
+    static constexpr const char *trace_path = "trace.json";
 
     bool should_quit = false;
-    glm::vec2 control_points[3] = {
-        glm::vec2(-0.75, -0.75),
-        glm::vec2(0, 0.75),
-        glm::vec2(0.75, -0.75),
-    };
-    std::vector<glm::vec2> bezier_line_segments;
+    bool trace_dump_requested = false;
+    // Every curve is an entity with ControlPoints and BezierSegments. The RenderSystem sizes its buffers for the curves
+    // that exist when it is created.
+    utils::ComponentStore curves;
     //    glm::ivec2 mouse_pos = {screen_width / 2, screen_height / 2};
     std::optional<glm::ivec2> mouse_held_pos;
     std::optional<u32> clicked_point;
+
+    RenderState render_state;
+
+    DataManager()
+    {
+        curves.Create(ControlPoints{{glm::vec2(-0.75, -0.75), glm::vec2(0, 0.75), glm::vec2(0.75, -0.75)}},
+            BezierSegments{});
+    }
+
+    // True if any curve's T component changed since the RenderStateSystem last copied it into render_state
+    template<typename T>
+    bool AnyDirty() const
+    {
+        for (const auto &chunk : curves.Query<T>(utils::frame_arena::Get())) {
+            const auto *components = chunk.template Column<T>();
+            if (std::any_of(components, components + chunk.count, [](const T &component) { return component.dirty; })) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // True while a change still has to be simulated, copied into render_state or uploaded
+    bool HasPendingWork() const
+    {
+        return AnyDirty<ControlPoints>() || AnyDirty<BezierSegments>() || render_state.control_points_dirty
+            || render_state.bezier_line_segments_dirty;
+    }
 };
 
+// Work done per frame, logged with --counters
+static const utils::Counter g_input_events("input_events");
+static const utils::Counter g_curve_samples_evaluated("curve_samples_evaluated");
+static const utils::Counter g_vertex_bytes_uploaded("vertex_bytes_uploaded");
+
 class System
 {
   protected:
@@ -33,30 +145,146 @@ class System
     explicit System(DataManager *data_manager) : _data_manager(data_manager) {}
     virtual ~System() = default;
     virtual void Run() = 0;
+    virtual const char *Name() const = 0;
+    // The DataManager fields this system reads and writes in Run(). Systems that don't declare anything are assumed
+    // to touch everything and are never run alongside another system.
+    virtual DataAccess Access() const { return {DataField::All, DataField::All}; }
+    // Systems that use the graphics device have to run on the frame thread, which holds its context
+    virtual bool RequiresFrameThread() const { return false; }
 };
 
+// Input is collected on its own thread, independent of how long a frame takes. SDL only lets the thread that created
+// the window pump its events, so the main thread is the dedicated producer: RunPump() blocks on the event source and
+// pushes every event into a lock-free ring as soon as it arrives, while the frames run on a separate frame thread.
+// Run() is the consumer and executes on a worker at the start of each frame, folding everything queued so far into
+// the newest mouse state.
+//
+// Sources that deliver frames (scripts and replays) get a frame end marker queued after each of their frames, and
+// Run() consumes exactly one of their frames per frame, waiting for it if the pump is behind.
 class InputSystem : public System
 {
+    static constexpr u32 queue_capacity = 1024;
+
+    struct QueuedEvent {
+        SDL_Event event;
+        bool frame_end;
+    };
+
+    std::unique_ptr<EventSource> _event_source;
+    std::unique_ptr<InputLogWriter> _log_writer;
+    const bool _delivers_frames;
+    utils::SpscQueue<QueuedEvent, queue_capacity> _events;
+    // Bumped by the producer after every push and by the consumer after every frame, so each side can block until the
+    // other one made progress
+    std::atomic<u32> _pushed = 0;
+    std::atomic<u32> _consumed = 0;
+    std::atomic<bool> _stop_pump = false;
+
   public:
-    explicit InputSystem(DataManager *data_manager) : System(data_manager) {}
+    InputSystem(DataManager *data_manager, std::unique_ptr<EventSource> event_source,
+        std::unique_ptr<InputLogWriter> log_writer) :
+            System(data_manager),
+            _event_source(std::move(event_source)),
+            _log_writer(std::move(log_writer)),
+            _delivers_frames(_event_source->DeliversFrames())
+    {
+    }
+    const char *Name() const override { return "InputSystem"; }
+    DataAccess Access() const override
+    {
+        return {DataField::None, DataField::ShouldQuit | DataField::MouseHeldPos | DataField::TraceDumpRequested};
+    }
     void Run() override
     {
-        SDL_Event e;
-        while (SDL_PollEvent(&e) > 0) {
+        // Motion events overwrite each other, so after the loop mouse_held_pos holds the newest position
+        QueuedEvent queued;
+        while (true) {
+            if (!_events.Pop(&queued)) {
+                if (!_delivers_frames) {
+                    break;
+                }
+                WaitForEvent();
+                continue;
+            }
+            if (queued.frame_end) {
+                break;
+            }
+            const auto &e = queued.event;
+            COUNTER_ADD(g_input_events, 1);
+            if (_log_writer) {
+                _log_writer->Write(e);
+            }
             if (e.type == SDL_QUIT) {
                 _data_manager->should_quit = true;
-                return;
+                break;
             } else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
                 _data_manager->mouse_held_pos = {e.button.x, e.button.y};
             } else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT) {
                 _data_manager->mouse_held_pos.reset();
             } else if (e.type == SDL_MOUSEMOTION && _data_manager->mouse_held_pos) {
                 _data_manager->mouse_held_pos = {e.motion.x, e.motion.y};
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == DataManager::trace_dump_key) {
+                _data_manager->trace_dump_requested = true;
+            }
+        }
+        if (_log_writer) {
+            _log_writer->EndFrame();
+        }
+        _consumed.fetch_add(1, std::memory_order_release);
+        _consumed.notify_one();
+    }
+
+    // Consumer side, blocks until an event is queued, leaving it for the next Run()
+    void WaitForEvent()
+    {
+        const u32 pushed = _pushed.load(std::memory_order_acquire);
+        if (_events.Empty()) {
+            _pushed.wait(pushed, std::memory_order_acquire);
+        }
+    }
+
+    // Producer loop, has to run on the thread that created the window. Returns once StopPump() was called.
+    void RunPump()
+    {
+        QueuedEvent queued = {};
+        bool have_event = false;
+        while (!_stop_pump.load(std::memory_order_acquire)) {
+            if (!have_event) {
+                queued = {};
+                if (!_event_source->Poll(&queued.event)) {
+                    if (!_delivers_frames) {
+                        _event_source->Wait();
+                        continue;
+                    }
+                    queued.frame_end = true;
+                }
+                have_event = true;
+            }
+            if (_events.Push(queued)) {
+                have_event = false;
+                _pushed.fetch_add(1, std::memory_order_release);
+                _pushed.notify_one();
+            } else {
+                // Full, wait until the consumer finished another frame
+                const u32 consumed = _consumed.load(std::memory_order_acquire);
+                if (_events.Full() && !_stop_pump.load(std::memory_order_acquire)) {
+                    _consumed.wait(consumed, std::memory_order_acquire);
+                }
             }
         }
     }
+
+    // Makes RunPump() return, may be called from any thread
+    void StopPump()
+    {
+        _stop_pump.store(true, std::memory_order_release);
+        _consumed.fetch_add(1, std::memory_order_release);
+        _consumed.notify_one();
+        _event_source->Wake();
+    }
 };
 
+#ifndef HEADLESS_ONLY
 // TODO: I can put these in their own .cpp files and only have a .h with a funcion for creating the system
 /*
 
@@ -73,6 +301,9 @@ class RenderSystem : public System
 {
     focus::Device *_device = nullptr;
     focus::Window _window;
+    // The OpenGL context focus created for the window, handed from the main thread to the frame thread
+    SDL_Window *_gl_window = nullptr;
+    SDL_GLContext _gl_context = nullptr;
 
     focus::SceneState _line_scene_state;
     focus::Pipeline _line_pipeline;
@@ -82,19 +313,35 @@ class RenderSystem : public System
 
     focus::DynamicVertexBuffer _control_point_buffer;
     focus::DynamicVertexBuffer _line_buffer;
+    // The vertex buffers hold this many curves. focus can't free a buffer to make a bigger one, so the number of curves
+    // has to stay the same for as long as the RenderSystem exists.
+    u32 _curve_count = 0;
+
+    auto LoadShader(const char *name, const char *vertex_path, const char *fragment_path)
+    {
+        TRACE_SCOPE(name);
+        return _device->CreateShaderFromSource(
+            name, utils::ReadEntireFileAsString(vertex_path), utils::ReadEntireFileAsString(fragment_path));
+    }
 
   public:
     explicit RenderSystem(DataManager *data_manager) : System(data_manager)
     {
         _device = focus::Device::Init(focus::RendererAPI::OpenGL);
+        _curve_count = _data_manager->curves.Count<ControlPoints>();
         _window = _device->MakeWindow(DataManager::screen_width, DataManager::screen_height);
+        _gl_window = SDL_GL_GetCurrentWindow();
+        _gl_context = SDL_GL_GetCurrentContext();
+        if (!_gl_window || !_gl_context) {
+            printf("Failed to get the OpenGL context of the window: %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
 
         //
         // Init line pipeline
         //
 
-        auto line_shader = _device->CreateShaderFromSource("line_shader",
-            utils::ReadEntireFileAsString("shaders/line.vert"), utils::ReadEntireFileAsString("shaders/line.frag"));
+        auto line_shader = LoadShader("line_shader", "shaders/line.vert", "shaders/line.frag");
 
         // TODO: implement a line rendering pipeline
         focus::PipelineState line_pipeline_state = {
@@ -123,8 +370,10 @@ class RenderSystem : public System
         focus::ConstantBufferLayout line_cb_layout("Constants");
         line_cb_layout.Add("color and mvp", focus::VarType::Float4x4);
 
-        _line_buffer = _device->CreateDynamicVertexBuffer(line_vb_layout, _data_manager->bezier_line_segments.data(),
-            _data_manager->bezier_line_segments.size() * sizeof(glm::vec2));
+        // Filled in by the first upload, render_state starts out dirty
+        std::vector<glm::vec2> line_segments(_curve_count * BezierSegments::count);
+        _line_buffer = _device->CreateDynamicVertexBuffer(
+            line_vb_layout, line_segments.data(), line_segments.size() * sizeof(glm::vec2));
         _line_scene_state = {
             .dynamic_vb_handles = {_line_buffer},
             .cb_handles = {_device->CreateConstantBuffer(line_cb_layout, line_mvp, sizeof(line_mvp))},
@@ -134,8 +383,7 @@ class RenderSystem : public System
         // Init point pipeline
         //
 
-        auto point_shader = _device->CreateShaderFromSource("point_shader",
-            utils::ReadEntireFileAsString("shaders/point.vert"), utils::ReadEntireFileAsString("shaders/point.frag"));
+        auto point_shader = LoadShader("point_shader", "shaders/point.vert", "shaders/point.frag");
 
         focus::PipelineState point_pipeline_state = {
             .shader = point_shader,
@@ -161,28 +409,65 @@ class RenderSystem : public System
         focus::ConstantBufferLayout point_cb_layout("Constants");
         point_cb_layout.Add("color size and mvp", focus::VarType::Float4x4);
 
+        std::vector<glm::vec2> control_points(_curve_count * 3);
         _control_point_buffer = _device->CreateDynamicVertexBuffer(
-            point_vb_layout, _data_manager->control_points, sizeof(_data_manager->control_points));
+            point_vb_layout, control_points.data(), control_points.size() * sizeof(glm::vec2));
         point_scene_state = {
             .dynamic_vb_handles = {_control_point_buffer},
             .cb_handles = {_device->CreateConstantBuffer(point_cb_layout, point_mvp, sizeof(point_mvp))},
         };
     }
 
+    const char *Name() const override { return "RenderSystem"; }
+
+    // The context can only be current on one thread at a time, so it has to be released before another thread can make
+    // it current
+    void MakeContextCurrent()
+    {
+        if (SDL_GL_MakeCurrent(_gl_window, _gl_context) != 0) {
+            printf("Failed to make the OpenGL context current: %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
+    }
+    void ReleaseContext() { SDL_GL_MakeCurrent(_gl_window, nullptr); }
+
+    // Only touches the render_state snapshot, so it can run while the next frame is simulated. Clearing the dirty
+    // flags after an upload counts as a write.
+    DataAccess Access() const override { return {DataField::None, DataField::RenderState}; }
+    bool RequiresFrameThread() const override { return true; }
+
     void Run() override
     {
-        _device->UpdateDynamicVertexBuffer(
-            _control_point_buffer, _data_manager->control_points, sizeof(_data_manager->control_points));
-        //        auto line_points = CreateBezierLines();
-        _device->UpdateDynamicVertexBuffer(_line_buffer, _data_manager->bezier_line_segments.data(),
-            _data_manager->bezier_line_segments.size() * sizeof(glm::vec2));
+        auto &render_state = _data_manager->render_state;
+        if (render_state.control_points.size() != _curve_count * 3
+            || render_state.bezier_line_segments.size() != _curve_count * BezierSegments::count) {
+            printf("The number of curves changed from %u to %zu after the RenderSystem was created, which it doesn't "
+                   "support\n",
+                _curve_count, render_state.control_points.size() / 3);
+            exit(EXIT_FAILURE);
+        }
+        // Only re-upload the buffers whose contents actually changed since the last frame
+        if (render_state.control_points_dirty) {
+            _device->UpdateDynamicVertexBuffer(_control_point_buffer, render_state.control_points.data(),
+                render_state.control_points.size() * sizeof(glm::vec2));
+            COUNTER_ADD(g_vertex_bytes_uploaded, render_state.control_points.size() * sizeof(glm::vec2));
+            render_state.control_points_dirty = false;
+        }
+        if (render_state.bezier_line_segments_dirty) {
+            _device->UpdateDynamicVertexBuffer(_line_buffer, render_state.bezier_line_segments.data(),
+                render_state.bezier_line_segments.size() * sizeof(glm::vec2));
+            COUNTER_ADD(g_vertex_bytes_uploaded, render_state.bezier_line_segments.size() * sizeof(glm::vec2));
+            render_state.bezier_line_segments_dirty = false;
+        }
 
         _device->ClearBackBuffer({});
         _device->BeginPass("Line Pass");
 
         _device->BindSceneState(_line_scene_state);
         _device->BindPipeline(_line_pipeline);
-        _device->Draw(focus::Primitive::LineStrip, 0, 100);
+        for (u32 curve = 0; curve < _curve_count; curve++) {
+            _device->Draw(focus::Primitive::LineStrip, curve * BezierSegments::count, BezierSegments::count);
+        }
 
         _device->EndPass();
 
@@ -190,47 +475,66 @@ class RenderSystem : public System
 
         _device->BindSceneState(point_scene_state);
         _device->BindPipeline(point_pipeline);
-        _device->Draw(focus::Primitive::Points, 0, 3);
+        _device->Draw(focus::Primitive::Points, 0, _curve_count * 3);
 
         _device->EndPass();
 
         _device->SwapBuffers(_window);
     }
 };
+#endif
 
 class PointSystem : public System
 {
-    std::optional<u32> _point_index;
+    struct HeldPoint {
+        utils::Entity curve;
+        u32 index;
+    };
+    std::optional<HeldPoint> _held_point;
 
   public:
     explicit PointSystem(DataManager *data_manager) : System(data_manager) {}
+    const char *Name() const override { return "PointSystem"; }
+    DataAccess Access() const override { return {DataField::MouseHeldPos, DataField::ControlPoints}; }
     void Run() override
     {
         if (!_data_manager->mouse_held_pos) {
-            _point_index.reset();
+            _held_point.reset();
             return;
         }
         const auto &mouse_pos = _data_manager->mouse_held_pos.value();
-        if (!_point_index) {
-            _point_index = PointHitByMouse(mouse_pos);
+        if (!_held_point) {
+            _held_point = PointHitByMouse(mouse_pos);
         }
-        if (_point_index) {
-            _data_manager->control_points[_point_index.value()] =
+        if (_held_point) {
+            const auto new_pos =
                 utils::ScreenSpaceToNDC(mouse_pos, DataManager::screen_width, DataManager::screen_height);
+            auto &control_points = _data_manager->curves.Get<ControlPoints>(_held_point->curve);
+            auto &control_point = control_points.points[_held_point->index];
+            if (control_point != new_pos) {
+                control_point = new_pos;
+                control_points.dirty = true;
+            }
         }
     }
 
   private:
-    std::optional<u32> PointHitByMouse(const glm::ivec2 &mouse_pos)
+    std::optional<HeldPoint> PointHitByMouse(const glm::ivec2 &mouse_pos)
     {
-        for (u32 i = 0; i < 3; i++) {
-            const auto &point = utils::NDCToScreenSpace(
-                _data_manager->control_points[i], DataManager::screen_width, DataManager::screen_height);
-            const auto lower_left = point - (static_cast<s32>(DataManager::point_size) / 2);
-            const auto upper_right = point + (static_cast<s32>(DataManager::point_size) / 2);
-            if (glm::all(glm::lessThanEqual(lower_left, mouse_pos))
-                && glm::all(glm::greaterThanEqual(upper_right, mouse_pos))) {
-                return i;
+        // Walks the ControlPoints column of each chunk front to back
+        for (const auto &chunk : _data_manager->curves.Query<ControlPoints>(utils::frame_arena::Get())) {
+            const auto *control_points = chunk.Column<ControlPoints>();
+            for (u32 curve = 0; curve < chunk.count; curve++) {
+                for (u32 i = 0; i < 3; i++) {
+                    const auto &point = utils::NDCToScreenSpace(
+                        control_points[curve].points[i], DataManager::screen_width, DataManager::screen_height);
+                    const auto lower_left = point - (static_cast<s32>(DataManager::point_size) / 2);
+                    const auto upper_right = point + (static_cast<s32>(DataManager::point_size) / 2);
+                    if (glm::all(glm::lessThanEqual(lower_left, mouse_pos))
+                        && glm::all(glm::greaterThanEqual(upper_right, mouse_pos))) {
+                        return HeldPoint{chunk.entities[curve], i};
+                    }
+                }
             }
         }
         return {};
@@ -239,55 +543,410 @@ class PointSystem : public System
 
 class LineSystem : public System
 {
+    // Bernstein basis weights for each sample parameter. The curve is always sampled at the same parameters, so these
+    // are computed once and tessellation reduces to a weighted sum of the control points.
+    f32 _basis0[BezierSegments::count];
+    f32 _basis1[BezierSegments::count];
+    f32 _basis2[BezierSegments::count];
+
   public:
     explicit LineSystem(DataManager *data_manager) : System(data_manager)
     {
-        _data_manager->bezier_line_segments = CreateBezierLines();
+        for (u32 i = 0; i < BezierSegments::count; i++) {
+            const f32 t = static_cast<f32>(i) / static_cast<f32>(BezierSegments::count);
+            _basis0[i] = (1.0f - t) * (1.0f - t);
+            _basis1[i] = 2.0f * t * (1.0f - t);
+            _basis2[i] = t * t;
+        }
+        Tessellate();
+    }
+    const char *Name() const override { return "LineSystem"; }
+    DataAccess Access() const override { return {DataField::ControlPoints, DataField::BezierLineSegments}; }
+    void Run() override
+    {
+        // The curve only changes when one of its control points does, so keep the cached segments otherwise
+        if (!_data_manager->AnyDirty<ControlPoints>()) {
+            return;
+        }
+        Tessellate();
     }
-    void Run() override { _data_manager->bezier_line_segments = CreateBezierLines(); }
 
-    static glm::vec2 QuadraticBezier(const f32 t, const glm::vec2 &p0, const glm::vec2 &p1, const glm::vec2 &p2)
+    // Re-tessellates the curves whose control points moved, walking the ControlPoints and BezierSegments columns of
+    // each chunk side by side. Chunks are independent of each other, so each one is a separate ParallelFor item when
+    // this runs inside the thread pool. The constructor runs before the pool exists and tessellates serially.
+    void Tessellate()
     {
-        return glm::mix(glm::mix(p0, p1, t), glm::mix(p1, p2, t), t);
+        const auto chunks = _data_manager->curves.Query<ControlPoints, BezierSegments>(utils::frame_arena::Get());
+        const auto tessellate_chunks = [this, &chunks](const u32 begin, const u32 end) {
+            for (u32 i = begin; i < end; i++) {
+                const auto *control_points = chunks[i].Column<ControlPoints>();
+                auto *segments = chunks[i].Column<BezierSegments>();
+                for (u32 curve = 0; curve < chunks[i].count; curve++) {
+                    if (control_points[curve].dirty) {
+                        CreateBezierLines(control_points[curve], segments[curve]);
+                    }
+                }
+            }
+        };
+        const u32 chunk_count = static_cast<u32>(chunks.size());
+        if (auto *thread_pool = utils::ThreadPool::Current()) {
+            thread_pool->ParallelFor(0, chunk_count, 1, tessellate_chunks);
+        } else {
+            tessellate_chunks(0, chunk_count);
+        }
     }
 
-    std::vector<glm::vec2> CreateBezierLines()
+    void CreateBezierLines(const ControlPoints &control_points, BezierSegments &segments)
     {
-        std::vector<glm::vec2> points;
-        for (u32 i = 0; i < 100; i++) {
-            points.emplace_back(QuadraticBezier(static_cast<f32>(i) / 100.0f, _data_manager->control_points[0],
-                _data_manager->control_points[1], _data_manager->control_points[2]));
+        const auto &p0 = control_points.points[0];
+        const auto &p1 = control_points.points[1];
+        const auto &p2 = control_points.points[2];
+        for (u32 i = 0; i < BezierSegments::count; i++) {
+            segments.points[i] = p0 * _basis0[i] + p1 * _basis1[i] + p2 * _basis2[i];
         }
-        return points;
+        segments.dirty = true;
+        COUNTER_ADD(g_curve_samples_evaluated, BezierSegments::count);
     }
 };
 
+// Publishes the simulation results of the previous frame to DataManager::render_state. It runs at the start of the
+// frame, after which the RenderSystem submits that snapshot while the simulation systems work on the next frame.
+class RenderStateSystem : public System
+{
+  public:
+    explicit RenderStateSystem(DataManager *data_manager) : System(data_manager) {}
+    const char *Name() const override { return "RenderStateSystem"; }
+    DataAccess Access() const override
+    {
+        return {DataField::None, DataField::ControlPoints | DataField::BezierLineSegments | DataField::RenderState};
+    }
+    void Run() override
+    {
+        if (!_data_manager->AnyDirty<ControlPoints>() && !_data_manager->AnyDirty<BezierSegments>()) {
+            return;
+        }
+        auto &render_state = _data_manager->render_state;
+        const auto chunks = _data_manager->curves.Query<ControlPoints, BezierSegments>(utils::frame_arena::Get());
+        u32 curve_count = 0;
+        for (const auto &chunk : chunks) {
+            curve_count += chunk.count;
+        }
+        render_state.control_points.resize(curve_count * 3);
+        render_state.bezier_line_segments.resize(curve_count * BezierSegments::count);
+
+        // Only the curves that changed are copied, the rest of the snapshot is still up to date
+        u32 curve = 0;
+        for (const auto &chunk : chunks) {
+            auto *control_points = chunk.Column<ControlPoints>();
+            auto *segments = chunk.Column<BezierSegments>();
+            for (u32 i = 0; i < chunk.count; i++, curve++) {
+                if (control_points[i].dirty) {
+                    std::copy(std::begin(control_points[i].points), std::end(control_points[i].points),
+                        render_state.control_points.begin() + curve * 3);
+                    control_points[i].dirty = false;
+                    render_state.control_points_dirty = true;
+                }
+                if (segments[i].dirty) {
+                    std::copy(std::begin(segments[i].points), std::end(segments[i].points),
+                        render_state.bezier_line_segments.begin() + curve * BezierSegments::count);
+                    segments[i].dirty = false;
+                    render_state.bezier_line_segments_dirty = true;
+                }
+            }
+        }
+    }
+};
+
+struct Options {
+    // Run without a window or graphics device, as fast as possible. Needs input_script or replay_path.
+    bool headless = false;
+    // Replace the window's input with a ScriptedEventSource or ReplayEventSource. The window itself keeps responding,
+    // and closing it still quits.
+    const char *input_script = nullptr;
+    const char *replay_path = nullptr;
+    // Write all input events to an input log that can be passed back in as replay_path
+    const char *record_path = nullptr;
+    // Write the counters of every frame to this file, as CSV if it ends in .csv and as JSON lines otherwise
+    const char *counters_path = nullptr;
+};
+
+static std::unique_ptr<EventSource> CreateEventSource(const Options &options)
+{
+    std::unique_ptr<EventSource> event_source;
+    if (options.input_script) {
+        event_source = std::make_unique<ScriptedEventSource>(options.input_script);
+    } else if (options.replay_path) {
+        event_source = std::make_unique<ReplayEventSource>(options.replay_path);
+    }
+#ifndef HEADLESS_ONLY
+    if (!event_source) {
+        event_source = std::make_unique<SDLEventSource>();
+    } else if (!options.headless) {
+        // The window still needs its events pumped, otherwise it stops responding and can't be closed
+        event_source = std::make_unique<WindowedPlaybackEventSource>(std::move(event_source));
+    }
+#endif
+    return event_source;
+}
+
 class SystemManager : public System
 {
     std::vector<std::unique_ptr<System>> _systems;
+    // Indices of the earlier systems each system conflicts with and therefore has to wait for
+    std::vector<std::vector<u32>> _dependencies;
+    // Created on the frame thread, so that thread owns the pool's first deque
+    std::optional<utils::ThreadPool> _thread_pool;
+    utils::FramePacer _frame_pacer{DataManager::target_frame_rate};
+    InputSystem *_input_system = nullptr;
+#ifndef HEADLESS_ONLY
+    RenderSystem *_render_system = nullptr;
+#endif
+    bool _headless;
+#ifdef ENABLE_PROFILING
+    std::chrono::steady_clock::time_point _last_profile_report = std::chrono::steady_clock::now();
+#endif
+#ifdef ENABLE_COUNTERS
+    std::unique_ptr<utils::counters::Log> _counter_log;
+    u64 _frame = 0;
+#endif
 
   public:
-    explicit SystemManager(DataManager *data_manager) : System(data_manager)
+    SystemManager(DataManager *data_manager, const Options &options) :
+            System(data_manager), _headless(options.headless)
     {
-        _systems.emplace_back(new InputSystem(data_manager));
+        utils::trace::SetThreadName("Main");
+        if (options.counters_path) {
+#ifdef ENABLE_COUNTERS
+            const Size length = strlen(options.counters_path);
+            const bool csv = length >= 4 && strcmp(options.counters_path + length - 4, ".csv") == 0;
+            _counter_log = std::make_unique<utils::counters::Log>(
+                options.counters_path, csv ? utils::counters::Format::Csv : utils::counters::Format::JsonLines);
+#else
+            printf("Built without ENABLE_COUNTERS, ignoring --counters\n");
+#endif
+        }
+        _input_system = new InputSystem(data_manager, CreateEventSource(options),
+            options.record_path ? std::make_unique<InputLogWriter>(options.record_path) : nullptr);
+        _systems.emplace_back(new RenderStateSystem(data_manager));
+        _systems.emplace_back(_input_system);
         _systems.emplace_back(new PointSystem(data_manager));
         _systems.emplace_back(new LineSystem(data_manager));
-        _systems.emplace_back(new RenderSystem(data_manager));
+#ifndef HEADLESS_ONLY
+        // The RenderSystem owns the window and graphics device, so it is the only system left out when headless
+        if (!_headless) {
+            _render_system = new RenderSystem(data_manager);
+            _systems.emplace_back(_render_system);
+        }
+#endif
+        BuildDependencies();
     }
+    const char *Name() const override { return "SystemManager"; }
+    // The main thread created the window, so it stays behind as the dedicated input pump while the frames run on their
+    // own thread. Slow frames therefore never hold up input collection.
     void Run() override
     {
+#ifndef HEADLESS_ONLY
+        if (_render_system) {
+            _render_system->ReleaseContext();
+        }
+#endif
+        std::thread frame_thread([this] {
+            RunFrames();
+            _input_system->StopPump();
+        });
+        _input_system->RunPump();
+        frame_thread.join();
+#ifndef HEADLESS_ONLY
+        if (_render_system) {
+            _render_system->MakeContextCurrent();
+        }
+#endif
+    }
+
+  private:
+    void RunFrames()
+    {
+        utils::trace::SetThreadName("Frame");
+#ifndef HEADLESS_ONLY
+        if (_render_system) {
+            _render_system->MakeContextCurrent();
+        }
+#endif
+        _thread_pool.emplace();
         while (!_data_manager->should_quit) {
-            for (const auto &system : _systems) {
-                system->Run();
+            if (_headless) {
+                // There is no display to pace to, so batch runs and benchmarks go as fast as possible
+                RunFrame();
+            } else {
+                RunPacedFrames();
+            }
+            if (_data_manager->trace_dump_requested) {
+#ifdef ENABLE_TRACING
+                utils::trace::WriteChromeTrace(DataManager::trace_path);
+                printf("Wrote trace to %s\n", DataManager::trace_path);
+#endif
+                _data_manager->trace_dump_requested = false;
+            }
+#ifdef ENABLE_PROFILING
+            utils::profiler::Collect();
+            const auto now = std::chrono::steady_clock::now();
+            const f64 since_report = std::chrono::duration<f64>(now - _last_profile_report).count();
+            if (since_report >= DataManager::profile_report_interval) {
+                PrintReport();
+                _last_profile_report = now;
+            }
+#endif
+        }
+#ifdef ENABLE_PROFILING
+        utils::profiler::Collect();
+        PrintReport();
+#endif
+        _thread_pool.reset();
+#ifndef HEADLESS_ONLY
+        if (_render_system) {
+            _render_system->ReleaseContext();
+        }
+#endif
+    }
+
+#ifdef ENABLE_PROFILING
+    static void PrintReport()
+    {
+        utils::profiler::PrintReport();
+        printf("frame arena high water: %zu bytes\n", utils::frame_arena::HighWater());
+    }
+#endif
+
+    void RunPacedFrames()
+    {
+        if (!_data_manager->HasPendingWork()) {
+            // Nothing to simulate or draw, so sleep until the next input event instead of spinning
+            _input_system->WaitForEvent();
+            _frame_pacer.Reset();
+        }
+        _frame_pacer.WaitForNextStep();
+        for (u32 steps = _frame_pacer.Advance(); steps > 0 && !_data_manager->should_quit; steps--) {
+            RunFrame();
+        }
+    }
+
+    // A system depends on every earlier system it conflicts with, so registration order is preserved wherever two
+    // systems touch the same data
+    void BuildDependencies()
+    {
+        _dependencies.resize(_systems.size());
+        for (u32 i = 0; i < _systems.size(); i++) {
+            const auto access = _systems[i]->Access();
+            for (u32 j = 0; j < i; j++) {
+                if (access.ConflictsWith(_systems[j]->Access())) {
+                    _dependencies[i].push_back(j);
+                }
+            }
+        }
+    }
+
+    // Runs one frame as a job graph. Worker systems become jobs that start as soon as their dependencies finish.
+    // Frame-thread systems run here in registration order, each waiting only for its own dependencies, and release an
+    // empty marker job for anything that depends on them. This lets the RenderSystem submit the previous frame's
+    // render_state while the simulation systems are still running.
+    void RunFrame()
+    {
+        PROFILE_SCOPE("Frame");
+        TRACE_SCOPE("Frame");
+        // Nothing allocated from the frame arenas outlives the frame it was allocated in, and no jobs are running yet
+        utils::frame_arena::Reset();
+        std::pmr::vector<utils::TaskGroup> groups(_systems.size(), utils::frame_arena::Get());
+        std::pmr::vector<utils::ThreadPool::Job *> jobs(_systems.size(), utils::frame_arena::Get());
+        for (u32 i = 0; i < _systems.size(); i++) {
+            auto *system = _systems[i].get();
+            if (system->RequiresFrameThread()) {
+                jobs[i] = _thread_pool->Create(groups[i], [] {});
+            } else {
+                jobs[i] = _thread_pool->Create(groups[i], [system] {
+                    PROFILE_SCOPE(system->Name());
+                    TRACE_SCOPE(system->Name());
+                    system->Run();
+                });
+            }
+            for (const u32 dependency : _dependencies[i]) {
+                _thread_pool->Precede(jobs[dependency], jobs[i]);
+            }
+        }
+        for (u32 i = 0; i < _systems.size(); i++) {
+            if (!_systems[i]->RequiresFrameThread()) {
+                _thread_pool->Submit(jobs[i]);
+            }
+        }
+        for (u32 i = 0; i < _systems.size(); i++) {
+            if (!_systems[i]->RequiresFrameThread()) {
+                continue;
+            }
+            for (const u32 dependency : _dependencies[i]) {
+                _thread_pool->Wait(groups[dependency]);
+            }
+            {
+                PROFILE_SCOPE(_systems[i]->Name());
+                TRACE_SCOPE(_systems[i]->Name());
+                _systems[i]->Run();
             }
+            _thread_pool->Submit(jobs[i]);
         }
+        for (auto &group : groups) {
+            _thread_pool->Wait(group);
+        }
+#ifdef ENABLE_COUNTERS
+        // Every job of the frame has finished, so the counts belong to this frame alone
+        if (_counter_log) {
+            _counter_log->Write(_frame, utils::counters::Collect());
+        }
+        _frame++;
+#endif
     }
 };
 
 int main(int argc, char **argv)
 {
+    Options options;
+    bool valid_arguments = true;
+    for (s32 i = 1; i < argc && valid_arguments; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(argv[i], "--script") == 0 && has_value) {
+            options.input_script = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && has_value) {
+            options.replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && has_value) {
+            options.record_path = argv[++i];
+        } else if (strcmp(argv[i], "--counters") == 0 && has_value) {
+            options.counters_path = argv[++i];
+        } else {
+            valid_arguments = false;
+        }
+    }
+    if (options.input_script && options.replay_path) {
+        valid_arguments = false;
+    }
+    if (options.headless && !options.input_script && !options.replay_path) {
+        valid_arguments = false;
+    }
+#ifdef HEADLESS_ONLY
+    if (!options.headless) {
+        valid_arguments = false;
+    }
+#endif
+    if (!valid_arguments) {
+        printf("usage: %s [--headless] [--script <input script> | --replay <input log>] [--record <input log>] "
+               "[--counters <log>]\n",
+            argv[0]);
+#ifdef HEADLESS_ONLY
+        printf("This build has no renderer, so --headless is required\n");
+#endif
+        return EXIT_FAILURE;
+    }
+
     DataManager data_manager;
-    SystemManager system_manager(&data_manager);
+    SystemManager system_manager(&data_manager, options);
     system_manager.Run();
 
     return 0;
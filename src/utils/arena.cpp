@@ -0,0 +1,77 @@
+#include "arena.h"
+
+#include "per_thread.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace utils
+{
+void Arena::Reset()
+{
+    _high_water = std::max(_high_water, _used);
+    if (_blocks.size() > 1) {
+        const Size size = std::max(_block_size, _high_water);
+        _blocks.clear();
+        _blocks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+    }
+    _offset = 0;
+    _used = 0;
+}
+
+void *Arena::do_allocate(const Size bytes, const Size alignment)
+{
+    if (!_blocks.empty()) {
+        const auto &block = _blocks.back();
+        const auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+        const Size aligned = ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (aligned + bytes <= block.size) {
+            _used += aligned + bytes - _offset;
+            _offset = aligned + bytes;
+            return block.memory.get() + aligned;
+        }
+    }
+
+    // The rest of the current block is left unused. Over-allocate by the alignment so the start can be aligned.
+    const Size size = std::max(_block_size, bytes + alignment);
+    auto &block = _blocks.emplace_back(Block{std::make_unique_for_overwrite<std::byte[]>(size), size});
+    const auto base = reinterpret_cast<uintptr_t>(block.memory.get());
+    const Size aligned = ((base + alignment - 1) & ~(alignment - 1)) - base;
+    _used += aligned + bytes;
+    _offset = aligned + bytes;
+    return block.memory.get() + aligned;
+}
+
+namespace frame_arena
+{
+namespace
+{
+// Own type, so the frame arenas get a registry separate from any other per thread Arena
+struct FrameArena : Arena {
+};
+
+std::atomic<Size> g_high_water = 0;
+} // namespace
+
+std::pmr::memory_resource *Get()
+{
+    return &PerThread<FrameArena>::Local();
+}
+
+void Reset()
+{
+    Size used = 0;
+    PerThread<FrameArena>::ForEach([&used](FrameArena &arena) {
+        used += arena.Used();
+        arena.Reset();
+    });
+    g_high_water.store(std::max(g_high_water.load(std::memory_order_relaxed), used), std::memory_order_relaxed);
+}
+
+Size HighWater()
+{
+    return g_high_water.load(std::memory_order_relaxed);
+}
+} // namespace frame_arena
+
+} // namespace utils
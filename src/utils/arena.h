@@ -0,0 +1,61 @@
+#pragma once
+#include "utils.h"
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace utils
+{
+// Linear allocator: allocations bump an offset into the current block and deallocation does nothing, everything is
+// released at once by Reset(). When a block runs out a new one is chained on, and the next Reset() replaces the chain
+// with a single block big enough for the most memory ever used, so a steady workload stops touching the heap.
+class Arena : public std::pmr::memory_resource
+{
+    struct Block {
+        std::unique_ptr<std::byte[]> memory;
+        Size size;
+    };
+
+    Size _block_size;
+    std::vector<Block> _blocks;
+    // Offset into _blocks.back()
+    Size _offset = 0;
+    // Bytes handed out since the last reset, including alignment padding
+    Size _used = 0;
+    Size _high_water = 0;
+
+  public:
+    static constexpr Size default_block_size = 64 * 1024;
+
+    explicit Arena(Size block_size = default_block_size) : _block_size(block_size) {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // Invalidates everything allocated from the arena
+    void Reset();
+    Size Used() const { return _used; }
+    // Most bytes in use at once since the arena was created
+    Size HighWater() const { return std::max(_high_water, _used); }
+
+  protected:
+    void *do_allocate(Size bytes, Size alignment) override;
+    void do_deallocate(void *, Size, Size) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+// Memory for data that only lives until the end of the current frame, such as query results and job bookkeeping.
+// Every thread allocates from its own Arena, so no locking is needed on the hot path.
+namespace frame_arena
+{
+// The calling thread's arena, created on first use
+std::pmr::memory_resource *Get();
+// Resets every thread's arena. Must be called while no other thread is allocating from its arena, e.g. between
+// frames, and nothing allocated during the previous frame may still be in use.
+void Reset();
+// Most bytes used by all threads together in a single frame
+Size HighWater();
+} // namespace frame_arena
+
+} // namespace utils
@@ -0,0 +1,121 @@
+#include "component_store.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace utils
+{
+u32 NextComponentTypeId()
+{
+    static std::atomic<u32> next_id = 0;
+    const u32 id = next_id.fetch_add(1, std::memory_order_relaxed);
+    if (id >= ComponentStore::max_component_types) {
+        printf("Too many component types, at most %u are supported\n", ComponentStore::max_component_types);
+        exit(EXIT_FAILURE);
+    }
+    return id;
+}
+
+void ComponentStore::Destroy(const Entity entity)
+{
+    if (!Alive(entity)) {
+        return;
+    }
+    auto &location = _locations[entity.index];
+    auto &archetype = _archetypes[location.archetype];
+
+    // Keep the columns dense by moving the last entity of the archetype into the freed row
+    const u32 last_row = archetype.count - 1;
+    if (location.row != last_row) {
+        for (u32 column = 0; column < archetype.components.size(); column++) {
+            std::memcpy(archetype.Component(location.row, column), archetype.Component(last_row, column),
+                archetype.components[column].size);
+        }
+        const u32 capacity = archetype.chunk_capacity;
+        const Entity moved = archetype.Entities(last_row / capacity)[last_row % capacity];
+        archetype.Entities(location.row / capacity)[location.row % capacity] = moved;
+        _locations[moved.index].row = location.row;
+    }
+    archetype.count--;
+    if (archetype.count <= (archetype.chunks.size() - 1) * archetype.chunk_capacity) {
+        archetype.chunks.pop_back();
+    }
+
+    location.alive = false;
+    location.generation++;
+    _free_indices.push_back(entity.index);
+}
+
+u32 ComponentStore::FindOrCreateArchetype(std::vector<ComponentInfo> components)
+{
+    u64 mask = 0;
+    for (const auto &component : components) {
+        mask |= 1ull << component.type_id;
+    }
+    for (u32 i = 0; i < _archetypes.size(); i++) {
+        if (_archetypes[i].mask == mask) {
+            return i;
+        }
+    }
+
+    Archetype archetype;
+    archetype.mask = mask;
+    std::sort(components.begin(), components.end(),
+        [](const ComponentInfo &a, const ComponentInfo &b) { return a.type_id < b.type_id; });
+    archetype.components = std::move(components);
+    archetype.column_of.fill(Archetype::no_column);
+    for (u32 column = 0; column < archetype.components.size(); column++) {
+        archetype.column_of[archetype.components[column].type_id] = static_cast<u8>(column);
+    }
+
+    // Fit as many entities into a chunk as possible with every column starting on its own cache line
+    const auto align = [](const Size offset) { return (offset + cache_line - 1) & ~(cache_line - 1); };
+    Size entity_bytes = sizeof(Entity);
+    for (const auto &component : archetype.components) {
+        entity_bytes += component.size;
+    }
+    for (u32 capacity = static_cast<u32>(std::max<Size>(chunk_bytes / entity_bytes, 1)); capacity > 0; capacity--) {
+        archetype.column_offsets.clear();
+        Size offset = align(capacity * sizeof(Entity));
+        for (const auto &component : archetype.components) {
+            archetype.column_offsets.push_back(static_cast<u32>(offset));
+            offset = align(offset + capacity * component.size);
+        }
+        archetype.chunk_capacity = capacity;
+        archetype.chunk_size = offset;
+        if (offset <= chunk_bytes) {
+            break;
+        }
+    }
+
+    _archetypes.push_back(std::move(archetype));
+    return static_cast<u32>(_archetypes.size() - 1);
+}
+
+Entity ComponentStore::AllocateEntity(const u32 archetype_index)
+{
+    auto &archetype = _archetypes[archetype_index];
+    if (archetype.count == archetype.chunks.size() * archetype.chunk_capacity) {
+        archetype.chunks.emplace_back(
+            static_cast<std::byte *>(::operator new[](archetype.chunk_size, std::align_val_t(cache_line))));
+    }
+    const u32 row = archetype.count++;
+
+    Entity entity;
+    if (_free_indices.empty()) {
+        entity.index = static_cast<u32>(_locations.size());
+        _locations.emplace_back();
+    } else {
+        entity.index = _free_indices.back();
+        _free_indices.pop_back();
+    }
+    auto &location = _locations[entity.index];
+    entity.generation = location.generation;
+    location.archetype = archetype_index;
+    location.row = row;
+    location.alive = true;
+    archetype.Entities(row / archetype.chunk_capacity)[row % archetype.chunk_capacity] = entity;
+    return entity;
+}
+
+} // namespace utils
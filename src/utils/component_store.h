@@ -0,0 +1,188 @@
+#pragma once
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+namespace utils
+{
+struct Entity {
+    u32 index = 0;
+    u32 generation = 0;
+
+    bool operator==(const Entity &) const = default;
+};
+
+u32 NextComponentTypeId();
+
+// Small dense id per component type, used to build archetype masks
+template<typename T>
+u32 ComponentTypeId()
+{
+    static const u32 id = NextComponentTypeId();
+    return id;
+}
+
+// Entity component storage grouped by archetype. All entities with the same set of component types share an
+// archetype, whose components are stored as one contiguous column per type (structure of arrays) in fixed size
+// chunks. Queries hand out whole chunks, so a system walks each column linearly, and the chunks can be split across
+// threads with ThreadPool::ParallelFor.
+//
+// Components have to be trivially copyable, and an entity keeps the component types it was created with. Creating and
+// destroying entities must not overlap with queries or other threads accessing components.
+class ComponentStore
+{
+  public:
+    static constexpr u32 max_component_types = 64;
+    static constexpr Size chunk_bytes = 16 * 1024;
+    static constexpr Size cache_line = 64;
+
+    template<typename... Ts>
+    struct Chunk {
+        u32 count;
+        const Entity *entities;
+        std::tuple<Ts *...> columns;
+
+        template<typename T>
+        T *Column() const
+        {
+            return std::get<T *>(columns);
+        }
+    };
+
+  private:
+    struct ComponentInfo {
+        u32 type_id;
+        u32 size;
+    };
+
+    struct AlignedDelete {
+        void operator()(std::byte *memory) const { ::operator delete[](memory, std::align_val_t(cache_line)); }
+    };
+    using ChunkMemory = std::unique_ptr<std::byte[], AlignedDelete>;
+
+    struct Archetype {
+        static constexpr u8 no_column = 0xFF;
+
+        u64 mask = 0;
+        std::vector<ComponentInfo> components;
+        // Byte offset of each component's column inside a chunk, the entity ids are stored at offset 0
+        std::vector<u32> column_offsets;
+        // Index into components/column_offsets for each component type id
+        std::array<u8, max_component_types> column_of;
+        u32 chunk_capacity = 0;
+        Size chunk_size = 0;
+        std::vector<ChunkMemory> chunks;
+        u32 count = 0;
+
+        Entity *Entities(const u32 chunk) const { return reinterpret_cast<Entity *>(chunks[chunk].get()); }
+        std::byte *Column(const u32 chunk, const u32 column) const
+        {
+            return chunks[chunk].get() + column_offsets[column];
+        }
+        std::byte *Component(const u32 row, const u32 column) const
+        {
+            return Column(row / chunk_capacity, column) + (row % chunk_capacity) * components[column].size;
+        }
+        u32 ChunkCount(const u32 chunk) const { return std::min(chunk_capacity, count - chunk * chunk_capacity); }
+    };
+
+    struct Location {
+        u32 archetype = 0;
+        u32 row = 0;
+        u32 generation = 0;
+        bool alive = false;
+    };
+
+    std::vector<Archetype> _archetypes;
+    std::vector<Location> _locations;
+    std::vector<u32> _free_indices;
+
+  public:
+    template<typename... Ts>
+    Entity Create(const Ts &...components)
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> && ...), "components have to be trivially copyable");
+        const u32 archetype_index = FindOrCreateArchetype({ComponentInfo{ComponentTypeId<Ts>(), sizeof(Ts)}...});
+        auto &archetype = _archetypes[archetype_index];
+        const Entity entity = AllocateEntity(archetype_index);
+        (std::memcpy(archetype.Component(_locations[entity.index].row, archetype.column_of[ComponentTypeId<Ts>()]),
+             &components, sizeof(Ts)),
+            ...);
+        return entity;
+    }
+
+    void Destroy(Entity entity);
+
+    bool Alive(const Entity entity) const
+    {
+        return entity.index < _locations.size() && _locations[entity.index].alive
+            && _locations[entity.index].generation == entity.generation;
+    }
+
+    // The entity has to be alive and have a T component
+    template<typename T>
+    T &Get(const Entity entity)
+    {
+        const auto &location = _locations[entity.index];
+        const auto &archetype = _archetypes[location.archetype];
+        return *reinterpret_cast<T *>(archetype.Component(location.row, archetype.column_of[ComponentTypeId<T>()]));
+    }
+
+    // Every chunk of every archetype that has all of the given component types. The list is only valid until the next
+    // Create or Destroy, so it can be allocated from a short lived memory resource such as the frame arena.
+    template<typename... Ts>
+    std::pmr::vector<Chunk<Ts...>> Query(std::pmr::memory_resource *memory = std::pmr::get_default_resource()) const
+    {
+        const u64 required = ((1ull << ComponentTypeId<Ts>()) | ...);
+        std::pmr::vector<Chunk<Ts...>> chunks(memory);
+        for (const auto &archetype : _archetypes) {
+            if ((archetype.mask & required) != required) {
+                continue;
+            }
+            for (u32 chunk = 0; chunk < archetype.chunks.size(); chunk++) {
+                chunks.push_back({
+                    .count = archetype.ChunkCount(chunk),
+                    .entities = archetype.Entities(chunk),
+                    .columns = {reinterpret_cast<Ts *>(
+                        archetype.Column(chunk, archetype.column_of[ComponentTypeId<Ts>()]))...},
+                });
+            }
+        }
+        return chunks;
+    }
+
+    // Calls f(Ts &...) for every entity that has all of the given component types
+    template<typename... Ts, typename F>
+    void ForEach(F &&f) const
+    {
+        for (const auto &chunk : Query<Ts...>()) {
+            for (u32 i = 0; i < chunk.count; i++) {
+                f(chunk.template Column<Ts>()[i]...);
+            }
+        }
+    }
+
+    // Number of entities that have all of the given component types
+    template<typename... Ts>
+    u32 Count() const
+    {
+        u32 count = 0;
+        for (const auto &chunk : Query<Ts...>()) {
+            count += chunk.count;
+        }
+        return count;
+    }
+
+  private:
+    u32 FindOrCreateArchetype(std::vector<ComponentInfo> components);
+    Entity AllocateEntity(u32 archetype_index);
+};
+
+} // namespace utils
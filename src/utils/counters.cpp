@@ -0,0 +1,112 @@
+#include "counters.h"
+
+#include "per_thread.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace utils
+{
+namespace
+{
+struct ThreadCounters {
+    // Only written by the owning thread, read by Collect
+    std::atomic<u64> values[counters::max_counters] = {};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<const char *> names;
+    // Totals as of the previous Collect
+    u64 previous[counters::max_counters] = {};
+};
+
+// Function local so counters defined as globals in other files can register during static initialisation
+Registry &GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadCounters &LocalCounters()
+{
+    return PerThread<ThreadCounters>::Local();
+}
+} // namespace
+
+Counter::Counter(const char *name)
+{
+    auto &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    if (registry.names.size() == counters::max_counters) {
+        printf("Too many counters, at most %u are supported\n", counters::max_counters);
+        exit(EXIT_FAILURE);
+    }
+    _id = static_cast<u32>(registry.names.size());
+    registry.names.push_back(name);
+}
+
+void Counter::Add(const u64 amount) const
+{
+    // Single writer, so a plain load and store is enough and avoids a locked read-modify-write
+    auto &value = LocalCounters().values[_id];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+namespace counters
+{
+std::vector<Sample> Collect()
+{
+    auto &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    u64 totals[max_counters] = {};
+    PerThread<ThreadCounters>::ForEach([&registry, &totals](const ThreadCounters &thread) {
+        for (u32 id = 0; id < registry.names.size(); id++) {
+            totals[id] += thread.values[id].load(std::memory_order_relaxed);
+        }
+    });
+    std::vector<Sample> samples;
+    for (u32 id = 0; id < registry.names.size(); id++) {
+        samples.push_back({registry.names[id], totals[id] - registry.previous[id]});
+        registry.previous[id] = totals[id];
+    }
+    return samples;
+}
+
+Log::Log(const char *path, const Format format) :
+        _file(utils::OpenFile(path, utils::FilePermissions::Write)), _format(format)
+{
+}
+
+Log::~Log()
+{
+    fclose(_file);
+}
+
+void Log::Write(const u64 frame, const std::vector<Sample> &samples)
+{
+    if (_format == Format::Csv) {
+        if (!_wrote_header) {
+            fprintf(_file, "frame");
+            for (const auto &sample : samples) {
+                fprintf(_file, ",%s", sample.name);
+            }
+            fprintf(_file, "\n");
+            _wrote_header = true;
+        }
+        fprintf(_file, "%llu", static_cast<unsigned long long>(frame));
+        for (const auto &sample : samples) {
+            fprintf(_file, ",%llu", static_cast<unsigned long long>(sample.value));
+        }
+        fprintf(_file, "\n");
+    } else {
+        fprintf(_file, "{\"frame\":%llu", static_cast<unsigned long long>(frame));
+        for (const auto &sample : samples) {
+            fprintf(_file, ",\"%s\":%llu", sample.name, static_cast<unsigned long long>(sample.value));
+        }
+        fprintf(_file, "}\n");
+    }
+}
+} // namespace counters
+
+} // namespace utils
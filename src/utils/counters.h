@@ -0,0 +1,66 @@
+#pragma once
+#include "utils.h"
+
+#include <vector>
+
+// COUNTER_ADD(counter, amount) adds amount to a utils::Counter on the calling thread. Without ENABLE_COUNTERS it
+// expands to nothing.
+#ifdef ENABLE_COUNTERS
+#define COUNTER_ADD(counter, amount) (counter).Add(amount)
+#else
+#define COUNTER_ADD(counter, amount)
+#endif
+
+namespace utils
+{
+// Named count of work done, e.g. samples evaluated or bytes uploaded. Define counters as globals so they are all
+// registered before the first frame. Every thread adds to its own slot with relaxed atomics, so Add never contends
+// with other threads and only counters::Collect reads across threads.
+class Counter
+{
+    u32 _id;
+
+  public:
+    explicit Counter(const char *name);
+    Counter(const Counter &) = delete;
+    Counter &operator=(const Counter &) = delete;
+
+    void Add(u64 amount) const;
+};
+
+namespace counters
+{
+constexpr u32 max_counters = 64;
+
+struct Sample {
+    const char *name;
+    u64 value;
+};
+
+// Sums every thread's counts for each counter since the previous call, in registration order. Meant to be called once
+// per frame after all of its jobs have finished, from one thread at a time.
+std::vector<Sample> Collect();
+
+enum class Format {
+    Csv,
+    JsonLines,
+};
+
+// Writes one line per call to Write, with a header line first for CSV
+class Log
+{
+    FILE *_file;
+    Format _format;
+    bool _wrote_header = false;
+
+  public:
+    Log(const char *path, Format format);
+    ~Log();
+    Log(const Log &) = delete;
+    Log &operator=(const Log &) = delete;
+
+    void Write(u64 frame, const std::vector<Sample> &samples);
+};
+} // namespace counters
+
+} // namespace utils
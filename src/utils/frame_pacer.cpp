@@ -0,0 +1,68 @@
+#include "frame_pacer.h"
+
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+namespace utils
+{
+FramePacer::FramePacer(const f64 target_rate, const u32 max_steps_per_advance) :
+        _max_steps_per_advance(max_steps_per_advance)
+{
+    SetTargetRate(target_rate);
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::SetTargetRate(const f64 target_rate)
+{
+    _timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<f64>(1.0 / target_rate));
+}
+
+u32 FramePacer::Advance()
+{
+    const auto now = Clock::now();
+    _accumulator += now - _last_time;
+    _last_time = now;
+
+    const auto due_steps = _accumulator / _timestep;
+    if (due_steps > _max_steps_per_advance) {
+        _accumulator %= _timestep;
+        return _max_steps_per_advance;
+    }
+    _accumulator -= due_steps * _timestep;
+    return static_cast<u32>(due_steps);
+}
+
+void FramePacer::WaitForNextStep() const
+{
+    const auto deadline = _last_time + (_timestep - _accumulator);
+    const auto remaining = deadline - Clock::now();
+    if (remaining > spin_threshold) {
+        std::this_thread::sleep_for(remaining - spin_threshold);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::Reset()
+{
+    _last_time = Clock::now();
+    _accumulator = _timestep;
+}
+
+} // namespace utils
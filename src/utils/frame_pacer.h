@@ -0,0 +1,42 @@
+#pragma once
+#include "utils.h"
+
+#include <chrono>
+
+namespace utils
+{
+// Paces a loop to a fixed timestep. Elapsed real time goes into an accumulator, and every full timestep in it is one
+// step the caller should run. Waiting for the next step sleeps for most of the remaining time and spins only for the
+// last bit, since the OS sleep granularity is too coarse to hit the deadline on its own. On Windows the pacer raises
+// the system timer resolution to 1ms for its lifetime, otherwise a sleep can overshoot by a whole 15.6ms tick.
+class FramePacer
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Remaining time below which WaitForNextStep() spins instead of sleeping
+    static constexpr Clock::duration spin_threshold = std::chrono::milliseconds(2);
+
+    Clock::duration _timestep;
+    Clock::duration _accumulator = Clock::duration::zero();
+    Clock::time_point _last_time = Clock::now();
+    // Cap on the steps returned by a single Advance(), so a slow frame doesn't make the loop fall further behind
+    u32 _max_steps_per_advance;
+
+  public:
+    explicit FramePacer(f64 target_rate, u32 max_steps_per_advance = 1);
+    ~FramePacer();
+    FramePacer(const FramePacer &) = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    void SetTargetRate(f64 target_rate);
+    f64 Timestep() const { return std::chrono::duration<f64>(_timestep).count(); }
+
+    // Adds the time since the last call to the accumulator and consumes the steps that are due
+    u32 Advance();
+    // Blocks until at least one step is due
+    void WaitForNextStep() const;
+    // Drops the accumulated time and makes one step due right away, e.g. after the loop blocked while idle
+    void Reset();
+};
+
+} // namespace utils
@@ -0,0 +1,93 @@
+#pragma once
+#include "utils.h"
+
+#include <bit>
+
+namespace utils
+{
+// Occupancy of a 4x4x4 block of voxels, one bit per voxel. Bits are laid out x fastest, then y, then z, so each z
+// slab is a contiguous 16 bit lane and each x row a contiguous 4 bit lane. All queries are plain bitwise operations
+// on the packed mask rather than per voxel branches.
+struct OccupancyMask {
+    static constexpr u32 dimension = 4;
+    static constexpr u32 voxel_count = dimension * dimension * dimension;
+    static constexpr u64 row_bits = 0xFull;
+    static constexpr u64 slab_bits = 0xFFFFull;
+
+    u64 bits = 0;
+
+    static constexpr u32 Index(const u32 x, const u32 y, const u32 z)
+    {
+        return x + (y * dimension) + (z * dimension * dimension);
+    }
+    static constexpr u64 Bit(const u32 x, const u32 y, const u32 z) { return 1ull << Index(x, y, z); }
+
+    // Mask with every voxel inside the inclusive box [min, max] set
+    static constexpr OccupancyMask Box(
+        const u32 min_x, const u32 min_y, const u32 min_z, const u32 max_x, const u32 max_y, const u32 max_z)
+    {
+        const u64 row = (row_bits >> (dimension - 1 - (max_x - min_x))) << min_x;
+        u64 slab = 0;
+        for (u32 y = min_y; y <= max_y; y++) {
+            slab |= row << (y * dimension);
+        }
+        OccupancyMask mask;
+        for (u32 z = min_z; z <= max_z; z++) {
+            mask.bits |= slab << (z * dimension * dimension);
+        }
+        return mask;
+    }
+    static constexpr OccupancyMask Full() { return {~0ull}; }
+
+    constexpr bool Test(const u32 x, const u32 y, const u32 z) const { return (bits & Bit(x, y, z)) != 0; }
+    constexpr void Set(const u32 x, const u32 y, const u32 z) { bits |= Bit(x, y, z); }
+    constexpr void Clear(const u32 x, const u32 y, const u32 z) { bits &= ~Bit(x, y, z); }
+
+    constexpr u32 Count() const { return static_cast<u32>(std::popcount(bits)); }
+    constexpr bool Empty() const { return bits == 0; }
+    constexpr bool IsFull() const { return bits == ~0ull; }
+    constexpr bool Intersects(const OccupancyMask &other) const { return (bits & other.bits) != 0; }
+    constexpr bool Contains(const OccupancyMask &other) const { return (bits & other.bits) == other.bits; }
+
+    // Occupancy of a single z slab or x row, packed into the low bits
+    constexpr u16 Slab(const u32 z) const
+    {
+        return static_cast<u16>((bits >> (z * dimension * dimension)) & slab_bits);
+    }
+    constexpr u8 Row(const u32 y, const u32 z) const { return static_cast<u8>((bits >> Index(0, y, z)) & row_bits); }
+
+    // Index of the first occupied voxel, voxel_count if the mask is empty
+    constexpr u32 First() const { return static_cast<u32>(std::countr_zero(bits)); }
+
+    // Calls f(index) for every occupied voxel in ascending index order
+    template<typename F>
+    constexpr void ForEach(F &&f) const
+    {
+        for (u64 remaining = bits; remaining != 0; remaining &= remaining - 1) {
+            f(static_cast<u32>(std::countr_zero(remaining)));
+        }
+    }
+
+    constexpr OccupancyMask operator|(const OccupancyMask &other) const { return {bits | other.bits}; }
+    constexpr OccupancyMask operator&(const OccupancyMask &other) const { return {bits & other.bits}; }
+    constexpr OccupancyMask operator^(const OccupancyMask &other) const { return {bits ^ other.bits}; }
+    constexpr OccupancyMask operator~() const { return {~bits}; }
+    constexpr OccupancyMask &operator|=(const OccupancyMask &other)
+    {
+        bits |= other.bits;
+        return *this;
+    }
+    constexpr OccupancyMask &operator&=(const OccupancyMask &other)
+    {
+        bits &= other.bits;
+        return *this;
+    }
+    constexpr bool operator==(const OccupancyMask &other) const = default;
+};
+
+static_assert(OccupancyMask::Full().Count() == OccupancyMask::voxel_count);
+static_assert(OccupancyMask::Box(0, 0, 0, 3, 3, 3) == OccupancyMask::Full());
+static_assert(OccupancyMask::Box(1, 1, 1, 2, 2, 2).Count() == 8);
+static_assert(OccupancyMask::Box(3, 0, 2, 3, 0, 2).bits == OccupancyMask::Bit(3, 0, 2));
+
+} // namespace utils
@@ -0,0 +1,44 @@
+#pragma once
+#include "utils.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace utils
+{
+// Registry of one T per thread, for per thread buffers that another thread aggregates. A thread's instance is
+// created by its first Local() call, after which Local() is a thread_local pointer load. Instances are never freed,
+// so whatever a thread left behind when it exited can still be read. There is one registry per T, so wrap shared
+// types in a private struct.
+template<typename T>
+class PerThread
+{
+    inline static std::mutex _mutex;
+    inline static std::vector<std::unique_ptr<T>> _instances;
+
+  public:
+    static T &Local()
+    {
+        // Plain pointer rather than a thread_local object, so the hot path doesn't pay for a lazy initialisation check
+        static thread_local T *local = nullptr;
+        if (!local) {
+            std::lock_guard lock(_mutex);
+            local = _instances.emplace_back(std::make_unique<T>()).get();
+        }
+        return *local;
+    }
+
+    // Calls f(T &) for every registered instance in registration order. Holds the registry lock, so threads that
+    // haven't registered yet block in their first Local() until it returns.
+    template<typename F>
+    static void ForEach(F &&f)
+    {
+        std::lock_guard lock(_mutex);
+        for (const auto &instance : _instances) {
+            f(*instance);
+        }
+    }
+};
+
+} // namespace utils
@@ -0,0 +1,118 @@
+#include "profiler.h"
+
+#include "per_thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+
+namespace utils::profiler
+{
+namespace
+{
+struct Sample {
+    const char *name;
+    u64 duration_ns;
+};
+
+// Single producer, single consumer ring buffer. The owning thread records into it, Collect() drains it.
+struct ThreadBuffer {
+    static constexpr u32 capacity = 1024;
+
+    Sample samples[capacity];
+    std::atomic<u32> head = 0;
+    std::atomic<u32> tail = 0;
+    std::atomic<u32> dropped = 0;
+};
+
+struct Window {
+    u64 durations_ns[window_size];
+    u32 count = 0;
+    u32 next = 0;
+};
+
+// Only touched by the collecting thread. Keyed by the name pointer, so draining a sample doesn't have to build a string
+// or compare characters.
+std::unordered_map<const char *, Window> g_windows;
+u32 g_dropped = 0;
+
+ThreadBuffer &LocalBuffer()
+{
+    return PerThread<ThreadBuffer>::Local();
+}
+} // namespace
+
+void Record(const char *name, const u64 duration_ns)
+{
+    auto &buffer = LocalBuffer();
+    const u32 head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) == ThreadBuffer::capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.samples[head % ThreadBuffer::capacity] = {name, duration_ns};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Collect()
+{
+    PerThread<ThreadBuffer>::ForEach([](ThreadBuffer &buffer) {
+        const u32 head = buffer.head.load(std::memory_order_acquire);
+        u32 tail = buffer.tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            const auto &sample = buffer.samples[tail % ThreadBuffer::capacity];
+            auto &window = g_windows[sample.name];
+            window.durations_ns[window.next] = sample.duration_ns;
+            window.next = (window.next + 1) % window_size;
+            window.count = std::min(window.count + 1, window_size);
+        }
+        buffer.tail.store(tail, std::memory_order_release);
+        g_dropped += buffer.dropped.exchange(0, std::memory_order_relaxed);
+    });
+}
+
+std::vector<Stats> ComputeStats()
+{
+    // The same name can be spelled by different pointers, e.g. string literals in separate translation units, so the
+    // windows are merged by their contents here
+    std::map<std::string, std::vector<u64>> durations_by_name;
+    for (const auto &[name, window] : g_windows) {
+        auto &durations = durations_by_name[name];
+        durations.insert(durations.end(), window.durations_ns, window.durations_ns + window.count);
+    }
+
+    std::vector<Stats> stats;
+    for (auto &[name, sorted] : durations_by_name) {
+        std::sort(sorted.begin(), sorted.end());
+        u64 total = 0;
+        for (const auto duration : sorted) {
+            total += duration;
+        }
+        const auto count = static_cast<u32>(sorted.size());
+        const auto to_ms = [](const f64 ns) { return ns / 1.0e6; };
+        stats.push_back({
+            .name = name,
+            .sample_count = count,
+            .mean_ms = to_ms(static_cast<f64>(total) / count),
+            .p50_ms = to_ms(static_cast<f64>(sorted[(count - 1) / 2])),
+            .p99_ms = to_ms(static_cast<f64>(sorted[(count - 1) * 99 / 100])),
+            .max_ms = to_ms(static_cast<f64>(sorted.back())),
+        });
+    }
+    return stats;
+}
+
+void PrintReport()
+{
+    printf("%-20s %8s %10s %10s %10s %10s\n", "name", "samples", "mean ms", "p50 ms", "p99 ms", "max ms");
+    for (const auto &stats : ComputeStats()) {
+        printf("%-20s %8u %10.3f %10.3f %10.3f %10.3f\n", stats.name.c_str(), stats.sample_count, stats.mean_ms,
+            stats.p50_ms, stats.p99_ms, stats.max_ms);
+    }
+    if (g_dropped > 0) {
+        printf("%u samples dropped because a thread buffer was full\n", g_dropped);
+    }
+}
+
+} // namespace utils::profiler
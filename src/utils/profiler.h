@@ -0,0 +1,60 @@
+#pragma once
+#include "utils.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// PROFILE_SCOPE(name) times the rest of the enclosing scope and records it under name, which has to outlive the
+// profiler (string literals, System::Name()). Without ENABLE_PROFILING it expands to nothing.
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(name) utils::ScopedTimer UTILS_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+namespace utils
+{
+namespace profiler
+{
+struct Stats {
+    std::string name;
+    u32 sample_count;
+    f64 mean_ms;
+    f64 p50_ms;
+    f64 p99_ms;
+    f64 max_ms;
+};
+
+// Number of most recent samples per name that the statistics are computed over
+constexpr u32 window_size = 256;
+
+// Appends a sample to the calling thread's buffer. Lock free, safe to call from any thread.
+void Record(const char *name, u64 duration_ns);
+// Drains every thread's buffer into the rolling windows. Must only be called from one thread at a time, often
+// enough that the per thread buffers don't fill up (they hold 1024 samples each).
+void Collect();
+// Statistics over the rolling window of each recorded name, sorted by name
+std::vector<Stats> ComputeStats();
+void PrintReport();
+} // namespace profiler
+
+class ScopedTimer
+{
+    using Clock = std::chrono::steady_clock;
+
+    const char *_name;
+    Clock::time_point _start = Clock::now();
+
+  public:
+    explicit ScopedTimer(const char *name) : _name(name) {}
+    ~ScopedTimer()
+    {
+        profiler::Record(
+            _name, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count());
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+};
+
+} // namespace utils
@@ -0,0 +1,79 @@
+#pragma once
+#include "utils.h"
+
+#include <atomic>
+#include <bit>
+
+namespace utils
+{
+// Fixed capacity lock-free ring buffer for exactly one producer thread and one consumer thread. Each side keeps a
+// cached copy of the other side's index on its own cache line, so the shared indices are only read again when the
+// ring looks full or empty.
+template<typename T, u32 capacity>
+class SpscQueue
+{
+    static_assert(std::has_single_bit(capacity), "capacity has to be a power of two");
+    static constexpr u32 mask = capacity - 1;
+
+    // Consumer side
+    alignas(64) std::atomic<u32> _head = 0;
+    u32 _cached_tail = 0;
+    // Producer side
+    alignas(64) std::atomic<u32> _tail = 0;
+    u32 _cached_head = 0;
+
+    alignas(64) T _slots[capacity];
+
+  public:
+    // Producer only, returns false without pushing when the queue is full
+    bool Push(const T &value)
+    {
+        const u32 tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cached_head == capacity) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail - _cached_head == capacity) {
+                return false;
+            }
+        }
+        _slots[tail & mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer only
+    bool Full()
+    {
+        const u32 tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _cached_head == capacity) {
+            _cached_head = _head.load(std::memory_order_acquire);
+        }
+        return tail - _cached_head == capacity;
+    }
+
+    // Consumer only
+    bool Empty()
+    {
+        const u32 head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+        }
+        return head == _cached_tail;
+    }
+
+    // Consumer only, returns false when the queue is empty
+    bool Pop(T *value)
+    {
+        const u32 head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head == _cached_tail) {
+                return false;
+            }
+        }
+        *value = _slots[head & mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+} // namespace utils
@@ -0,0 +1,233 @@
+#include "thread_pool.h"
+
+#include "trace.h"
+
+namespace utils
+{
+struct ThreadPool::Job {
+    std::function<void()> function;
+    TaskGroup *group;
+    // One for the outstanding Submit() call plus one for every unfinished job this one was chained after
+    std::atomic<u32> blockers = 1;
+    std::vector<Job *> continuations;
+};
+
+// The pool and deque owned by the current thread, if any
+static thread_local ThreadPool *t_pool = nullptr;
+static thread_local u32 t_deque_index = 0;
+static thread_local u32 t_steal_seed = 0x9E3779B9u;
+
+bool ThreadPool::WorkStealingDeque::Push(Job *job)
+{
+    const s64 bottom = _bottom.load(std::memory_order_relaxed);
+    const s64 top = _top.load(std::memory_order_acquire);
+    if (bottom - top >= capacity) {
+        return false;
+    }
+    _buffer[bottom & mask].store(job, std::memory_order_relaxed);
+    // Publishes the job to thieves, which load _bottom with acquire
+    _bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+ThreadPool::Job *ThreadPool::WorkStealingDeque::Pop()
+{
+    const s64 bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 top = _top.load(std::memory_order_relaxed);
+    if (top > bottom) {
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job *job = _buffer[bottom & mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last job in the deque, race the thieves for it
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+ThreadPool::Job *ThreadPool::WorkStealingDeque::Steal()
+{
+    s64 top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const s64 bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+    Job *job = _buffer[top & mask].load(std::memory_order_relaxed);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+ThreadPool::ThreadPool(const u32 worker_count)
+{
+    for (u32 i = 0; i < worker_count + 1; i++) {
+        _deques.emplace_back(std::make_unique<WorkStealingDeque>());
+    }
+    t_pool = this;
+    t_deque_index = 0;
+
+    _workers.reserve(worker_count);
+    for (u32 i = 0; i < worker_count; i++) {
+        _workers.emplace_back([this, i] { WorkerLoop(i + 1); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    _shutting_down.store(true);
+    {
+        std::lock_guard lock(_sleep_mutex);
+        _work_available.notify_all();
+    }
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+    if (t_pool == this) {
+        t_pool = nullptr;
+    }
+}
+
+u32 ThreadPool::DefaultWorkerCount()
+{
+    const u32 hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+ThreadPool *ThreadPool::Current()
+{
+    return t_pool;
+}
+
+void ThreadPool::Wait(TaskGroup &group)
+{
+    while (!group.Done()) {
+        if (auto *job = FindJob()) {
+            Execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ThreadPool::Job *ThreadPool::Create(TaskGroup &group, std::function<void()> function)
+{
+    group._pending.fetch_add(1, std::memory_order_relaxed);
+    auto *job = new Job;
+    job->function = std::move(function);
+    job->group = &group;
+    return job;
+}
+
+void ThreadPool::Precede(Job *before, Job *after)
+{
+    after->blockers.fetch_add(1, std::memory_order_relaxed);
+    before->continuations.push_back(after);
+}
+
+void ThreadPool::Submit(Job *job)
+{
+    if (job->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Enqueue(job);
+    }
+}
+
+void ThreadPool::WorkerLoop(const u32 deque_index)
+{
+    t_pool = this;
+    t_deque_index = deque_index;
+    t_steal_seed += deque_index;
+    trace::SetThreadName("Worker");
+
+    while (true) {
+        const u64 seen_epoch = _work_epoch.load();
+        if (auto *job = FindJob()) {
+            Execute(job);
+            continue;
+        }
+        if (_shutting_down.load()) {
+            return;
+        }
+        // Nothing to do: sleep until something is submitted after the epoch we last looked at
+        _sleeping_workers.fetch_add(1);
+        {
+            std::unique_lock lock(_sleep_mutex);
+            _work_available.wait(lock, [&] { return _work_epoch.load() != seen_epoch || _shutting_down.load(); });
+        }
+        _sleeping_workers.fetch_sub(1);
+    }
+}
+
+ThreadPool::Job *ThreadPool::FindJob()
+{
+    if (t_pool == this) {
+        if (auto *job = _deques[t_deque_index]->Pop()) {
+            return job;
+        }
+    }
+    {
+        std::lock_guard lock(_injected_mutex);
+        if (!_injected_jobs.empty()) {
+            auto *job = _injected_jobs.front();
+            _injected_jobs.pop_front();
+            return job;
+        }
+    }
+    // Start stealing at a random victim so thieves don't all hammer the same deque
+    t_steal_seed ^= t_steal_seed << 13;
+    t_steal_seed ^= t_steal_seed >> 17;
+    t_steal_seed ^= t_steal_seed << 5;
+    const u32 deque_count = static_cast<u32>(_deques.size());
+    for (u32 i = 0; i < deque_count; i++) {
+        const u32 victim = (t_steal_seed + i) % deque_count;
+        if (t_pool == this && victim == t_deque_index) {
+            continue;
+        }
+        if (auto *job = _deques[victim]->Steal()) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::Execute(Job *job)
+{
+    {
+        TRACE_SCOPE("Job");
+        job->function();
+    }
+    for (auto *continuation : job->continuations) {
+        if (continuation->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Enqueue(continuation);
+        }
+    }
+    job->group->_pending.fetch_sub(1, std::memory_order_acq_rel);
+    delete job;
+}
+
+void ThreadPool::Enqueue(Job *job)
+{
+    if (t_pool != this || !_deques[t_deque_index]->Push(job)) {
+        std::lock_guard lock(_injected_mutex);
+        _injected_jobs.push_back(job);
+    }
+    WakeWorkers();
+}
+
+void ThreadPool::WakeWorkers()
+{
+    _work_epoch.fetch_add(1);
+    if (_sleeping_workers.load() > 0) {
+        std::lock_guard lock(_sleep_mutex);
+        _work_available.notify_one();
+    }
+}
+
+} // namespace utils
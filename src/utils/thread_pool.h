@@ -0,0 +1,113 @@
+#pragma once
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace utils
+{
+// Tracks a batch of jobs submitted to a ThreadPool so the submitter can wait for all of them to finish
+class TaskGroup
+{
+    friend class ThreadPool;
+    std::atomic<u32> _pending = 0;
+
+  public:
+    bool Done() const { return _pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing thread pool. Every worker, and the thread that created the pool, owns a Chase-Lev deque: jobs it
+// submits are pushed onto the bottom of its own deque and popped back LIFO, while idle threads steal the oldest jobs
+// from the top of the other deques. Jobs submitted from any other thread go through a shared injection queue.
+class ThreadPool
+{
+  public:
+    struct Job;
+
+  private:
+    // Fixed capacity Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+    // Push and Pop may only be called by the owning thread, Steal by any thread.
+    class WorkStealingDeque
+    {
+        static constexpr s64 capacity = 4096;
+        static constexpr s64 mask = capacity - 1;
+
+        alignas(64) std::atomic<s64> _top = 0;
+        alignas(64) std::atomic<s64> _bottom = 0;
+        std::unique_ptr<std::atomic<Job *>[]> _buffer = std::make_unique<std::atomic<Job *>[]>(capacity);
+
+      public:
+        bool Push(Job *job);
+        Job *Pop();
+        Job *Steal();
+    };
+
+    std::vector<std::thread> _workers;
+    // Index 0 belongs to the thread that created the pool, index i + 1 to _workers[i]
+    std::vector<std::unique_ptr<WorkStealingDeque>> _deques;
+
+    std::deque<Job *> _injected_jobs;
+    std::mutex _injected_mutex;
+
+    // Idle workers sleep on _work_available. _work_epoch is bumped on every submission so a worker that is about to
+    // sleep can tell whether work arrived after it last looked.
+    std::atomic<u64> _work_epoch = 0;
+    std::atomic<u32> _sleeping_workers = 0;
+    std::mutex _sleep_mutex;
+    std::condition_variable _work_available;
+    std::atomic<bool> _shutting_down = false;
+
+  public:
+    // Defaults to one worker per hardware thread, leaving one for the thread that submits the jobs
+    explicit ThreadPool(u32 worker_count = DefaultWorkerCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    static u32 DefaultWorkerCount();
+    // The pool that the calling thread created or works for, nullptr on any other thread. Lets code that runs inside
+    // a job split its own work across the same pool.
+    static ThreadPool *Current();
+    u32 WorkerCount() const { return static_cast<u32>(_workers.size()); }
+
+    void Run(TaskGroup &group, std::function<void()> function) { Submit(Create(group, std::move(function))); }
+    // Blocks until every job in the group has finished. The calling thread executes jobs while it waits, so this
+    // also makes progress when the pool has no workers.
+    void Wait(TaskGroup &group);
+
+    // Job graphs: Create() makes a job that won't run until it has been passed to Submit() and every job it was
+    // chained after with Precede() has finished. Precede() must be called before either job is submitted.
+    Job *Create(TaskGroup &group, std::function<void()> function);
+    void Precede(Job *before, Job *after);
+    void Submit(Job *job);
+
+    // Splits [begin, end) into chunks of at most grain_size items and calls f(chunk_begin, chunk_end) for each chunk
+    // across the pool, returning once all of them are done
+    template<typename F>
+    void ParallelFor(const u32 begin, const u32 end, const u32 grain_size, F &&f)
+    {
+        TaskGroup group;
+        const u32 grain = std::max(grain_size, 1u);
+        for (u32 chunk_begin = begin; chunk_begin < end;) {
+            const u32 chunk_end = end - chunk_begin > grain ? chunk_begin + grain : end;
+            Run(group, [&f, chunk_begin, chunk_end] { f(chunk_begin, chunk_end); });
+            chunk_begin = chunk_end;
+        }
+        Wait(group);
+    }
+
+  private:
+    void WorkerLoop(u32 deque_index);
+    Job *FindJob();
+    void Execute(Job *job);
+    void Enqueue(Job *job);
+    void WakeWorkers();
+};
+
+} // namespace utils
@@ -0,0 +1,136 @@
+#include "trace.h"
+
+#include "per_thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace utils::trace
+{
+namespace
+{
+struct Event {
+    const char *name;
+    u64 begin;
+    u64 end;
+};
+
+struct ClockPoint {
+    u64 ticks;
+    std::chrono::steady_clock::time_point time;
+
+    static ClockPoint Now() { return {trace::Now(), std::chrono::steady_clock::now()}; }
+};
+
+// Taken when the first thread registers and compared against a second one when writing the trace to find out how
+// long a tick is
+ClockPoint g_calibration_start;
+u32 g_next_thread_id = 0;
+
+struct ThreadBuffer {
+    static constexpr u32 capacity = 1 << 16;
+
+    Event events[capacity];
+    // Total number of events ever recorded, only written by the owning thread
+    std::atomic<u64> count = 0;
+    // Set by the owning thread while another one may be writing the trace
+    std::atomic<const char *> name = nullptr;
+    u32 id;
+
+    // Constructed by PerThread while it holds the registry lock
+    ThreadBuffer() : id(g_next_thread_id++)
+    {
+        if (id == 0) {
+            g_calibration_start = ClockPoint::Now();
+        }
+    }
+};
+
+ThreadBuffer &LocalBuffer()
+{
+    return PerThread<ThreadBuffer>::Local();
+}
+
+// Calls f(event) for every event the buffer still holds, oldest first
+template<typename F>
+void ForEachEvent(const ThreadBuffer &buffer, F &&f)
+{
+    const u64 count = buffer.count.load(std::memory_order_acquire);
+    const u64 oldest = count > ThreadBuffer::capacity ? count - ThreadBuffer::capacity : 0;
+    for (u64 i = oldest; i < count; i++) {
+        f(buffer.events[i % ThreadBuffer::capacity]);
+    }
+}
+
+void WriteJsonString(FILE *fp, const char *string)
+{
+    fputc('"', fp);
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', fp);
+        }
+        fputc(*c, fp);
+    }
+    fputc('"', fp);
+}
+} // namespace
+
+void Record(const char *name, const u64 begin, const u64 end)
+{
+    auto &buffer = LocalBuffer();
+    const u64 count = buffer.count.load(std::memory_order_relaxed);
+    buffer.events[count % ThreadBuffer::capacity] = {name, begin, end};
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char *name)
+{
+    LocalBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+void WriteChromeTrace(const char *path)
+{
+    // Timestamps are written in microseconds relative to the earliest event. Events are recorded when their scope ends,
+    // so an outer scope is stored after the scopes nested in it and the oldest slot of a ring that wrapped around
+    // doesn't necessarily hold the earliest begin.
+    u64 first_timestamp = ~0ull;
+    PerThread<ThreadBuffer>::ForEach([&first_timestamp](const ThreadBuffer &buffer) {
+        ForEachEvent(buffer, [&first_timestamp](const Event &event) {
+            first_timestamp = std::min(first_timestamp, event.begin);
+        });
+    });
+#ifdef TRACE_USE_TSC
+    const auto calibration_end = ClockPoint::Now();
+    const auto elapsed = std::chrono::duration<f64, std::micro>(calibration_end.time - g_calibration_start.time);
+    const f64 us_per_tick = elapsed.count() / static_cast<f64>(calibration_end.ticks - g_calibration_start.ticks);
+#else
+    const f64 us_per_tick = std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::duration(1)).count();
+#endif
+    const auto to_us = [us_per_tick](const s64 ticks) { return static_cast<f64>(ticks) * us_per_tick; };
+
+    auto *fp = OpenFile(path, FilePermissions::Write);
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    PerThread<ThreadBuffer>::ForEach([&](const ThreadBuffer &buffer) {
+        if (const char *name = buffer.name.load(std::memory_order_relaxed)) {
+            fprintf(fp, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":",
+                first ? "" : ",\n", buffer.id);
+            WriteJsonString(fp, name);
+            fprintf(fp, "}}");
+            first = false;
+        }
+        ForEachEvent(buffer, [&](const Event &event) {
+            fprintf(fp, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", first ? "" : ",\n",
+                buffer.id, to_us(static_cast<s64>(event.begin - first_timestamp)),
+                to_us(static_cast<s64>(event.end - event.begin)));
+            WriteJsonString(fp, event.name);
+            fputc('}', fp);
+            first = false;
+        });
+    });
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+}
+
+} // namespace utils::trace
@@ -0,0 +1,59 @@
+#pragma once
+#include "utils.h"
+
+#include <chrono>
+
+// Reading the time stamp counter is several times cheaper than going through the OS clock, which keeps the cost of an
+// event well below 50ns. Ticks are converted to real time only when the trace is written out.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRACE_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// TRACE_SCOPE(name) records the enclosing scope as one event on the calling thread's timeline. name has to outlive
+// the trace (string literals, System::Name()). Without ENABLE_TRACING it expands to nothing.
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name) utils::TraceScope UTILS_CONCAT(trace_scope_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
+
+namespace utils
+{
+namespace trace
+{
+// Timestamp in ticks of the time stamp counter, or of the steady clock where there is none
+inline u64 Now()
+{
+#ifdef TRACE_USE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+// Appends an event to the calling thread's ring buffer, overwriting the oldest one once it is full
+void Record(const char *name, u64 begin, u64 end);
+// Label for the calling thread's timeline in the trace viewer
+void SetThreadName(const char *name);
+// Writes the buffered events of every thread in the Chrome trace event format, which can be loaded in Perfetto or
+// chrome://tracing. Must be called while no other thread is recording, e.g. between frames.
+void WriteChromeTrace(const char *path);
+} // namespace trace
+
+class TraceScope
+{
+    const char *_name;
+    u64 _begin = trace::Now();
+
+  public:
+    explicit TraceScope(const char *name) : _name(name) {}
+    ~TraceScope() { trace::Record(_name, _begin, trace::Now()); }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+};
+
+} // namespace utils
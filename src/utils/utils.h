@@ -16,6 +16,10 @@ typedef float f32;
 typedef double f64;
 typedef size_t Size;
 
+// Pastes two tokens together after expanding them, e.g. to give a variable a unique name with __LINE__
+#define UTILS_CONCAT_INNER(a, b) a##b
+#define UTILS_CONCAT(a, b)       UTILS_CONCAT_INNER(a, b)
+
 namespace utils
 {
 enum class FilePermissions {